@@ -25,7 +25,7 @@ run_test() {
     echo -n "Testing $test_name... "
     
     # Compile the test
-    if $COMPILER "$test_file" > /tmp/test_output.txt 2>&1; then
+    if $COMPILER --emit=llvm-ir -o - "$test_file" > /tmp/test_output.txt 2>&1; then
         # Check if compilation succeeded (LLVM IR was generated)
         if grep -q "ModuleID" /tmp/test_output.txt; then
             echo "PASS"
@@ -58,7 +58,7 @@ verify_ir() {
     echo -n "Verifying $test_name IR for $expected_type... "
     
     # Compile and capture IR (ignore linker errors)
-    $COMPILER "$test_file" > /tmp/ir_output.txt 2>&1
+    $COMPILER --emit=llvm-ir -o - "$test_file" > /tmp/ir_output.txt 2>&1
     
     if grep -q "$expected_type" /tmp/ir_output.txt; then
         echo "PASS"
@@ -87,6 +87,7 @@ verify_ir "$TEST_DIR/test_u32.jam" "i32"
 
 # Test mixed types
 run_test "$TEST_DIR/test_mixed_types.jam"
+run_test "$TEST_DIR/test_negative_literals.jam"
 
 # Test if/else functionality
 run_test "$TEST_DIR/test_if_else.jam"
@@ -103,12 +104,24 @@ run_test "$TEST_DIR/test_string.jam"
 run_test "$TEST_DIR/test_slices.jam"
 run_test "$TEST_DIR/test_mixed_slices.jam"
 
+# Test struct layout
+run_test "$TEST_DIR/test_struct_layout.jam"
+
+# Test error unions
+run_test "$TEST_DIR/test_error_union.jam"
+
+# Test function multiversioning
+run_test "$TEST_DIR/test_target_clones.jam"
+
+# Test target constants
+run_test "$TEST_DIR/test_target_constants.jam"
+
 echo ""
 echo "Running specific IR verification tests..."
 
 # Verify specific type usage in IR
 echo -n "Checking u8 max value (255)... "
-$COMPILER "$TEST_DIR/test_u8.jam" > /tmp/u8_ir.txt 2>&1
+$COMPILER --emit=llvm-ir -o - "$TEST_DIR/test_u8.jam" > /tmp/u8_ir.txt 2>&1
 if grep -q "i8 -1\|i8 255" /tmp/u8_ir.txt; then  # 255 might appear as -1 in signed representation
     echo "PASS"
     ((PASSED++))
@@ -118,7 +131,7 @@ else
 fi
 
 echo -n "Checking u16 large values... "
-$COMPILER "$TEST_DIR/test_u16.jam" > /tmp/u16_ir.txt 2>&1
+$COMPILER --emit=llvm-ir -o - "$TEST_DIR/test_u16.jam" > /tmp/u16_ir.txt 2>&1
 if grep -q "i16.*65535\|i16.*30000\|i16.*20000" /tmp/u16_ir.txt; then
     echo "PASS"
     ((PASSED++))
@@ -128,7 +141,7 @@ else
 fi
 
 echo -n "Checking u32 very large values... "
-$COMPILER "$TEST_DIR/test_u32.jam" > /tmp/u32_ir.txt 2>&1
+$COMPILER --emit=llvm-ir -o - "$TEST_DIR/test_u32.jam" > /tmp/u32_ir.txt 2>&1
 if grep -q "i32.*4294967295\|i32.*1000000" /tmp/u32_ir.txt; then
     echo "PASS"
     ((PASSED++))
@@ -137,8 +150,18 @@ else
     ((FAILED++))
 fi
 
+echo -n "Checking negative literals in 32-bit contexts... "
+$COMPILER --run --no-cache "$TEST_DIR/test_negative_literals.jam" > /tmp/negative_out.txt 2>&1
+if grep -q "Program exited with code: 199" /tmp/negative_out.txt; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+
 echo -n "Checking if/else IR generation... "
-$COMPILER "$TEST_DIR/test_if_else.jam" > /tmp/if_ir.txt 2>&1
+$COMPILER --emit=llvm-ir -o - "$TEST_DIR/test_if_else.jam" > /tmp/if_ir.txt 2>&1
 if grep -q "icmp eq\|br i1\|label %then\|label %else" /tmp/if_ir.txt; then
     echo "PASS"
     ((PASSED++))
@@ -148,7 +171,7 @@ else
 fi
 
 echo -n "Checking comparison operators... "
-$COMPILER "$TEST_DIR/test_if_else.jam" > /tmp/cmp_ir.txt 2>&1
+$COMPILER --emit=llvm-ir -o - "$TEST_DIR/test_if_else.jam" > /tmp/cmp_ir.txt 2>&1
 if grep -q "icmp ugt\|icmp eq\|icmp ne\|icmp ult\|icmp uge" /tmp/cmp_ir.txt; then
     echo "PASS"
     ((PASSED++))
@@ -158,7 +181,7 @@ else
 fi
 
 echo -n "Checking bool type IR generation... "
-$COMPILER "$TEST_DIR/test_bool.jam" > /tmp/bool_ir.txt 2>&1
+$COMPILER --emit=llvm-ir -o - "$TEST_DIR/test_bool.jam" > /tmp/bool_ir.txt 2>&1
 if grep -q "i1\|true\|false" /tmp/bool_ir.txt; then
     echo "PASS"
     ((PASSED++))
@@ -168,7 +191,7 @@ else
 fi
 
 echo -n "Checking bool function signatures... "
-$COMPILER "$TEST_DIR/test_bool.jam" > /tmp/bool_func_ir.txt 2>&1
+$COMPILER --emit=llvm-ir -o - "$TEST_DIR/test_bool.jam" > /tmp/bool_func_ir.txt 2>&1
 if grep -q "define i1.*bool\|i1 %flag" /tmp/bool_func_ir.txt; then
     echo "PASS"
     ((PASSED++))
@@ -178,7 +201,7 @@ else
 fi
 
 echo -n "Checking string slice IR generation... "
-$COMPILER "$TEST_DIR/test_string.jam" > /tmp/string_ir.txt 2>&1
+$COMPILER --emit=llvm-ir -o - "$TEST_DIR/test_string.jam" > /tmp/string_ir.txt 2>&1
 if grep -q "{ ptr, i64 }\|@str.*constant.*c\"" /tmp/string_ir.txt; then
     echo "PASS"
     ((PASSED++))
@@ -188,7 +211,7 @@ else
 fi
 
 echo -n "Checking slice type IR generation... "
-$COMPILER "$TEST_DIR/test_slices.jam" > /tmp/slice_ir.txt 2>&1
+$COMPILER --emit=llvm-ir -o - "$TEST_DIR/test_slices.jam" > /tmp/slice_ir.txt 2>&1
 if grep -q "{ ptr, i64 }\|zeroinitializer" /tmp/slice_ir.txt; then
     echo "PASS"
     ((PASSED++))
@@ -198,7 +221,7 @@ else
 fi
 
 echo -n "Checking UTF-8 string handling... "
-$COMPILER "$TEST_DIR/test_string.jam" > /tmp/utf8_ir.txt 2>&1
+$COMPILER --emit=llvm-ir -o - "$TEST_DIR/test_string.jam" > /tmp/utf8_ir.txt 2>&1
 if grep -q "\\\\E4\\\\B8\\\\96\\\\E7\\\\95\\\\8C\|\\\\F0\\\\9F\\\\8C\\\\8D" /tmp/utf8_ir.txt; then
     echo "PASS"
     ((PASSED++))
@@ -207,6 +230,473 @@ else
     ((FAILED++))
 fi
 
+echo -n "Checking struct field reordering... "
+$COMPILER --emit=llvm-ir -o - "$TEST_DIR/test_struct_layout.jam" > /tmp/struct_ir.txt 2>&1
+if grep -q "%Packet = type { { ptr, i64 }, i32, i16, i1, i8 }\|%Packet = type { { i8\*, i64 }, i32, i16, i1, i8 }" /tmp/struct_ir.txt; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+
+echo -n "Checking extern struct keeps C layout... "
+if grep -q "%CHeader = type { i8, i32, i16 }" /tmp/struct_ir.txt; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+
+echo -n "Checking --print-layouts report... "
+$COMPILER --print-layouts "$TEST_DIR/test_struct_layout.jam" > /tmp/layout_report.txt 2>&1
+if grep -q "struct Packet: size 24, align 8, padding 0 (reordered)" /tmp/layout_report.txt && \
+   grep -q "    20  id: u16 (size 2, align 2) @hot$" /tmp/layout_report.txt && \
+   grep -q "     0  hits: u32 (size 4, align 4) @hot$" /tmp/layout_report.txt; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+
+echo -n "Checking error union lowering... "
+$COMPILER --emit=llvm-ir -o - "$TEST_DIR/test_error_union.jam" > /tmp/errunion_ir.txt 2>&1
+if grep -q "%error_union.u32 = type { i32, i16 }" /tmp/errunion_ir.txt; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+
+echo -n "Checking error paths are marked cold... "
+if grep -q "branch_weights\", i32 1, i32 2000" /tmp/errunion_ir.txt; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+
+echo -n "Checking @target_clones ifunc dispatch... "
+$COMPILER --emit=llvm-ir -o - "$TEST_DIR/test_target_clones.jam" > /tmp/clones_ir.txt 2>&1
+if grep -q "@checksum = ifunc" /tmp/clones_ir.txt && grep -q "\"target-features\"=\"+avx512f\"" /tmp/clones_ir.txt; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+
+echo -n "Checking bad @target_clones are reported... "
+printf '@target_clones("avx2")\nexport fn checksum(a: u32) -> u32 {\n    return a;\n}\n' > /tmp/jam_bad_clones.jam
+if ! $COMPILER --emit=llvm-ir -o - /tmp/jam_bad_clones.jam > /tmp/jam_bad_clones_out.txt 2>&1 &&
+   grep -q "Error: @target_clones on checksum must include \"default\"" /tmp/jam_bad_clones_out.txt; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+rm -f /tmp/jam_bad_clones.jam
+
+echo -n "Checking --cpu/--features in --target-info... "
+$COMPILER --target-info --cpu=skylake --features=+avx2 "$TEST_DIR/test_u8.jam" > /tmp/cpu_info.txt 2>&1
+if grep -q "CPU: skylake" /tmp/cpu_info.txt && grep -q "Features: +avx2" /tmp/cpu_info.txt; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+
+echo -n "Checking @target constants and usize... "
+$COMPILER --emit=llvm-ir -o - "$TEST_DIR/test_target_constants.jam" > /tmp/target_const_ir.txt 2>&1
+if grep -q "define internal i64 @length(i64\|define internal i32 @length(i32" /tmp/target_const_ir.txt && grep -q "ret i32 8\|ret i32 4" /tmp/target_const_ir.txt; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+
+echo -n "Checking --profile-generate instrumentation... "
+$COMPILER --emit=llvm-ir -o - --profile-generate=/tmp/jam_test.profraw "$TEST_DIR/test_if_else.jam" > /tmp/pgo_ir.txt 2>&1
+if grep -q "__llvm_profile_filename" /tmp/pgo_ir.txt && grep -q "__profc_" /tmp/pgo_ir.txt; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+
+echo -n "Checking missing return is rejected... "
+printf 'fn pick(a: u8) -> u8 {\n    if (a > 1) {\n        if (a > 2) { return 2; } else { return 1; }\n    } else {\n        return 0;\n    }\n}\n' > /tmp/jam_returns.jam
+printf 'fn pick(a: u8) -> u8 {\n    if (a > 1) {\n        return 1;\n    }\n}\n' > /tmp/jam_no_return.jam
+$COMPILER -O2 --emit=obj -o /tmp/jam_returns.o /tmp/jam_returns.jam > /dev/null 2>&1
+RETURNS_STATUS=$?
+$COMPILER -O2 --emit=obj -o /tmp/jam_no_return.o /tmp/jam_no_return.jam > /tmp/jam_no_return_out.txt 2>&1
+if [ $RETURNS_STATUS -eq 0 ] && ! [ -e /tmp/jam_no_return.o ] &&
+   grep -q "non-void function pick does not return a value on all paths" /tmp/jam_no_return_out.txt; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+rm -f /tmp/jam_returns.jam /tmp/jam_returns.o /tmp/jam_no_return.jam /tmp/jam_no_return.o
+
+echo -n "Checking --run and --interp reject a non-integer main... "
+printf 'fn main() -> !u32 {\n    return 0;\n}\n' > /tmp/jam_main_union.jam
+$COMPILER --run /tmp/jam_main_union.jam > /tmp/jam_main_union_run.txt 2>&1
+RUN_STATUS=$?
+$COMPILER --interp /tmp/jam_main_union.jam > /tmp/jam_main_union_interp.txt 2>&1
+INTERP_STATUS=$?
+if [ $RUN_STATUS -ne 0 ] && [ $INTERP_STATUS -ne 0 ] &&
+   grep -q "Error: main must return an integer or nothing" /tmp/jam_main_union_run.txt &&
+   grep -q "Error: main must return an integer or nothing" /tmp/jam_main_union_interp.txt; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+rm -f /tmp/jam_main_union.jam
+
+echo -n "Checking --lto=thin bitcode output... "
+rm -f /tmp/jam_lto.bc
+$COMPILER --lto=thin --emit=bc -o /tmp/jam_lto.bc "$TEST_DIR/test_export.jam" > /dev/null 2>&1
+if [ "$(head -c 2 /tmp/jam_lto.bc 2>/dev/null)" = "BC" ]; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+rm -f /tmp/jam_lto.bc
+
+echo -n "Checking --emit=obj,asm with -o... "
+rm -f /tmp/jam_emit.o /tmp/jam_emit.s
+$COMPILER --emit=obj,asm -o /tmp/jam_emit.o "$TEST_DIR/test_export.jam" > /dev/null 2>&1
+if [ -s /tmp/jam_emit.o ] && grep -q "exported_func" /tmp/jam_emit.s 2>/dev/null; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+rm -f /tmp/jam_emit.o /tmp/jam_emit.s
+
+echo -n "Checking executable linking... "
+rm -f /tmp/jam_linked
+$COMPILER --verbose -o /tmp/jam_linked "$TEST_DIR/test_export.jam" > /tmp/jam_link_out.txt 2>&1
+if grep -q "^\[link\]" /tmp/jam_link_out.txt && /tmp/jam_linked; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+rm -f /tmp/jam_linked
+
+echo -n "Checking in-process lld linking... "
+if $COMPILER --target-info "$TEST_DIR/test_u8.jam" 2>/dev/null | grep -q "Linker: lld"; then
+    rm -f /tmp/jam_lld_linked
+    $COMPILER --verbose -o /tmp/jam_lld_linked "$TEST_DIR/test_export.jam" > /tmp/jam_lld_out.txt 2>&1
+    if grep -q "^\[link\] lld (in-process)" /tmp/jam_lld_out.txt && /tmp/jam_lld_linked; then
+        echo "PASS"
+        ((PASSED++))
+    else
+        echo "FAIL"
+        ((FAILED++))
+    fi
+    rm -f /tmp/jam_lld_linked
+else
+    echo "SKIP (jam built without lld)"
+fi
+
+echo -n "Checking --codegen-threads partitioned emission... "
+rm -f /tmp/jam_partitioned
+{
+    echo 'fn f0(a: u32) -> u32 { return a + 1; }'
+    for i in $(seq 1 1999); do
+        echo "fn f$i(a: u32) -> u32 { return f$((i - 1))(a) + 1; }"
+    done
+    echo 'fn main() -> u8 { const expected: u32 = 2000; if (f1999(0) == expected) { return 0; } return 1; }'
+} > /tmp/jam_partitioned.jam
+$COMPILER --codegen-threads=4 --verbose -o /tmp/jam_partitioned /tmp/jam_partitioned.jam > /tmp/jam_partitioned_out.txt 2>&1
+# Every function is internal and reached from main; they must still spread out
+if [ "$(grep -c "^\[codegen-threads\] partition [0-9]*: [1-9]" /tmp/jam_partitioned_out.txt)" -gt 1 ] &&
+   /tmp/jam_partitioned; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+rm -f /tmp/jam_partitioned /tmp/jam_partitioned.jam
+
+echo -n "Checking --codegen-threads is rejected with --lto... "
+if ! $COMPILER --codegen-threads=4 --lto=thin -o /tmp/jam_partitioned_lto "$TEST_DIR/test_if_else.jam" > /tmp/jam_partitioned_lto.txt 2>&1 &&
+   grep -q "Error: --codegen-threads cannot be combined with --lto" /tmp/jam_partitioned_lto.txt; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+rm -f /tmp/jam_partitioned_lto
+
+echo -n "Checking --stream pipelined compilation... "
+{
+    echo 'fn f0(a: u32) -> u32 { return a + 1; }'
+    for i in $(seq 1 4999); do
+        echo "fn f$i(a: u32) -> u32 { return f$((i - 1))(a) + 1; }"
+    done
+    echo 'fn main() -> u8 { const expected: u32 = 5000; if (f4999(0) == expected) { return 0; } return 1; }'
+} > /tmp/jam_stream.jam
+$COMPILER --stream -j 2 --verbose -o /tmp/jam_stream /tmp/jam_stream.jam > /tmp/jam_stream_out.txt 2>&1
+if grep -q "\[stream\] 5001 functions in [2-9]" /tmp/jam_stream_out.txt && /tmp/jam_stream; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+rm -f /tmp/jam_stream /tmp/jam_stream.jam
+
+echo -n "Checking --stream keeps Jam functions apart from C symbols... "
+cat > /tmp/jam_stream_c.jam << 'EOF'
+fn helper() -> u32 {
+    return 7;
+}
+
+fn main() -> u8 {
+    if (helper() == 7) {
+        return 0;
+    }
+    return 1;
+}
+EOF
+echo 'int helper(void) { return 1; }' > /tmp/jam_stream_helper.c
+if $COMPILER --stream -o /tmp/jam_stream_c /tmp/jam_stream_c.jam /tmp/jam_stream_helper.c > /tmp/jam_stream_c_out.txt 2>&1 &&
+   /tmp/jam_stream_c; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+rm -f /tmp/jam_stream_c /tmp/jam_stream_c.jam /tmp/jam_stream_helper.c
+
+echo -n "Checking --time-report and --time-trace... "
+rm -f /tmp/jam_trace.json
+$COMPILER -O2 --time-report --time-trace=/tmp/jam_trace.json --time-trace-granularity=0 \
+    --emit=obj -o /tmp/jam_timed.o "$TEST_DIR/test_if_else.jam" > /tmp/jam_time_out.txt 2>&1
+if grep -q "^Codegen " /tmp/jam_time_out.txt && grep -q "Slowest functions" /tmp/jam_time_out.txt &&
+   grep -q '"traceEvents"' /tmp/jam_trace.json && grep -q '"name":"Parse"' /tmp/jam_trace.json &&
+   grep -q '"name":"[A-Za-z]*Pass"' /tmp/jam_trace.json; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+rm -f /tmp/jam_timed.o /tmp/jam_trace.json
+
+echo -n "Checking --time-trace failures are reported... "
+$COMPILER --time-trace=/nonexistent/jam_trace.json --emit=obj -o /tmp/jam_timed.o "$TEST_DIR/test_if_else.jam" > /tmp/jam_time_fail_out.txt 2>&1
+TRACE_STATUS=$?
+$COMPILER --time-trace=/tmp/jam_trace.json --time-trace-granularity=-5 --emit=obj -o /tmp/jam_timed.o \
+    "$TEST_DIR/test_if_else.jam" > /tmp/jam_time_granularity_out.txt 2>&1
+GRANULARITY_STATUS=$?
+if [ $TRACE_STATUS -ne 0 ] && ! grep -q "Compilation completed successfully" /tmp/jam_time_fail_out.txt &&
+   [ $GRANULARITY_STATUS -ne 0 ] && grep -q "invalid --time-trace-granularity" /tmp/jam_time_granularity_out.txt; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+rm -f /tmp/jam_timed.o /tmp/jam_trace.json
+
+echo -n "Checking jam repl incremental definitions... "
+printf 'fn double(a: u32) -> u32 {\n    return a + a;\n}\ndouble(21)\n' | $COMPILER repl > /tmp/repl_out.txt 2>&1
+if grep -q "42" /tmp/repl_out.txt; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+
+echo -n "Checking --run --tiered tier-up... "
+$COMPILER --run --tiered --tier-threshold=10 --verbose "$TEST_DIR/test_tiered.jam" > /tmp/tiered_out.txt 2>/tmp/tiered_err.txt
+if grep -q "Program exited with code: 5000" /tmp/tiered_out.txt && grep -q "^\[tier-up\] count -> -O2" /tmp/tiered_err.txt; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+
+echo -n "Checking --run -j with speculative compilation... "
+$COMPILER --run --no-cache -j 4 "$TEST_DIR/test_tiered.jam" > /tmp/parallel_out.txt 2>&1
+if grep -q "Program exited with code: 5000" /tmp/parallel_out.txt; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+
+echo -n "Checking --run --hot-reload swaps a changed function... "
+cp "$TEST_DIR/test_hot_reload.jam" /tmp/hot_reload.jam
+$COMPILER --run --hot-reload /tmp/hot_reload.jam > /tmp/hot_reload_out.txt 2>&1 &
+HOT_PID=$!
+# Edit only once the watcher has taken the file's modification time
+for attempt in $(seq 1 100); do
+    grep -q "\[hot-reload\] watching" /tmp/hot_reload_out.txt && break
+    sleep 0.1
+done
+sed 's/return 1;/return 2;/' /tmp/hot_reload.jam > /tmp/hot_reload.jam.tmp && mv /tmp/hot_reload.jam.tmp /tmp/hot_reload.jam
+wait $HOT_PID
+if grep -q "\[hot-reload\] value in" /tmp/hot_reload_out.txt && grep -q "Program exited with code: 2" /tmp/hot_reload_out.txt; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+rm -f /tmp/hot_reload.jam /tmp/hot_reload.jam.tmp
+
+echo -n "Checking jam build with imported modules... "
+rm -rf /tmp/jam_build_app /tmp/jam_build_app_o2 /tmp/jam_build_cache
+$COMPILER build --cache-dir=/tmp/jam_build_cache tests/build/app.jam -j 2 -o /tmp/jam_build_app > /tmp/jam_build_out.txt 2>&1
+/tmp/jam_build_app
+if [ $? -eq 5 ] && grep -q "from 2 modules (0 cached)" /tmp/jam_build_out.txt; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+
+echo -n "Checking jam build caches module interfaces... "
+if [ "$(ls /tmp/jam_build_cache/build/*.jami 2>/dev/null | wc -l)" -eq 2 ]; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+
+echo -n "Checking jam build --no-cache writes interfaces beside objects... "
+rm -rf jam-build
+$COMPILER build --no-cache tests/build/app.jam -o /tmp/jam_build_app_nocache > /dev/null 2>&1
+if [ "$(ls jam-build/*.jami 2>/dev/null | wc -l)" -eq 2 ] && [ "$(ls jam-build/*.o 2>/dev/null | wc -l)" -eq 2 ]; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+rm -f /tmp/jam_build_app_nocache
+
+echo -n "Checking jam build rejects a struct defined by an import too... "
+rm -rf /tmp/jam_structs && mkdir -p /tmp/jam_structs
+printf 'struct Pair {\n    a: u8,\n    b: u32,\n}\n\nexport fn first() -> u32 {\n    return 1;\n}\n' > /tmp/jam_structs/pair.jam
+printf 'import "pair.jam";\n\nstruct Pair {\n    b: u32,\n}\n\nfn main() -> u32 {\n    return first();\n}\n' > /tmp/jam_structs/app.jam
+$COMPILER build --no-cache /tmp/jam_structs/app.jam -o /tmp/jam_structs/app > /tmp/jam_structs_out.txt 2>&1
+if [ $? -ne 0 ] && grep -q "struct Pair is defined in both" /tmp/jam_structs_out.txt; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+rm -rf /tmp/jam_structs
+
+echo -n "Checking jam build -O2 with imported inline bodies... "
+$COMPILER build --cache-dir=/tmp/jam_build_cache -O2 tests/build/app.jam -o /tmp/jam_build_app_o2 > /tmp/jam_build_o2_out.txt 2>&1
+/tmp/jam_build_app_o2
+if [ $? -eq 5 ]; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+
+echo -n "Checking jam build reuses cached modules... "
+$COMPILER build --cache-dir=/tmp/jam_build_cache tests/build/app.jam -o /tmp/jam_build_app > /tmp/jam_build_out.txt 2>&1
+if grep -q "is up to date" /tmp/jam_build_out.txt; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+
+echo -n "Checking jam build --use-server and jam --use-server... "
+rm -f /tmp/jam_server_app /tmp/jam_test.sock
+$COMPILER --server=/tmp/jam_test.sock > /tmp/jam_server_log.txt 2>&1 &
+SERVER_PID=$!
+sleep 1
+$COMPILER build --use-server=/tmp/jam_test.sock --cache-dir=/tmp/jam_build_cache tests/build/app.jam -o /tmp/jam_server_app > /tmp/jam_server_out.txt 2>&1
+/tmp/jam_server_app
+SERVER_APP_STATUS=$?
+$COMPILER --use-server=/tmp/jam_test.sock "$TEST_DIR/test_export.jam" -o /tmp/jam_server_single > /dev/null 2>&1
+/tmp/jam_server_single
+SERVER_SINGLE_STATUS=$?
+kill $SERVER_PID 2>/dev/null
+wait $SERVER_PID 2>/dev/null
+if [ $SERVER_APP_STATUS -eq 5 ] && grep -q "jam_server_app: ok" /tmp/jam_server_log.txt &&
+   [ $SERVER_SINGLE_STATUS -eq 0 ] && grep -q "jam_server_single: ok" /tmp/jam_server_log.txt; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+rm -f /tmp/jam_server_app /tmp/jam_server_single
+
+echo -n "Checking --interp matches --run... "
+$COMPILER --interp "$TEST_DIR/test_error_union.jam" > /tmp/interp_out.txt 2>&1
+$COMPILER --run --no-cache "$TEST_DIR/test_error_union.jam" > /tmp/interp_run_out.txt 2>&1
+if grep -q "Program exited with code: 0" /tmp/interp_out.txt && cmp -s /tmp/interp_out.txt /tmp/interp_run_out.txt; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+
+echo -n "Checking --interp agrees with --run on negative literals... "
+$COMPILER --interp "$TEST_DIR/test_negative_literals.jam" > /tmp/interp_negative_out.txt 2>&1
+$COMPILER --run --no-cache "$TEST_DIR/test_negative_literals.jam" > /tmp/interp_negative_run_out.txt 2>&1
+if grep -q "Program exited with code: 199" /tmp/interp_negative_out.txt &&
+   cmp -s /tmp/interp_negative_out.txt /tmp/interp_negative_run_out.txt; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+
+echo -n "Checking libjam embedding API... "
+cc -c -Isrc tests/embed/embed_host.c -o /tmp/embed_host.o > /tmp/embed_build.txt 2>&1 && \
+    c++ /tmp/embed_host.o build/libjam.a `llvm-config --ldflags --libs --system-libs` -lpthread -o /tmp/embed_host >> /tmp/embed_build.txt 2>&1
+if /tmp/embed_host 2>&1 | grep -q "^PASS$"; then
+    echo "PASS"
+    ((PASSED++))
+else
+    echo "FAIL"
+    ((FAILED++))
+fi
+
 echo ""
 echo "Test Results"
 echo "============"
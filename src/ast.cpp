@@ -7,30 +7,70 @@
 
 #include "ast.h"
 #include "codegen.h"
+#include "multiversion.h"
+#include "timing.h"
+#include <optional>
 #include <stdexcept>
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/IR/CFG.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/MDBuilder.h"
 
-// Global variables to track loop context for break/continue
-llvm::BasicBlock* CurrentLoopContinue = nullptr;
-llvm::BasicBlock* CurrentLoopBreak = nullptr;
+// Loop context for break/continue
+thread_local llvm::BasicBlock* CurrentLoopContinue = nullptr;
+thread_local llvm::BasicBlock* CurrentLoopBreak = nullptr;
+
+// Layout engine used to resolve struct field positions
+thread_local jam::LayoutEngine* CurrentLayouts = nullptr;
+
+// Functions generated into earlier modules of a pipelined compile
+thread_local const std::map<std::string, std::unique_ptr<FunctionAST>>* CurrentPrototypes = nullptr;
+
+// Integer literals get the smallest type that holds them as a signed value;
+// widen (or narrow) one to the type its context expects. Its sign bit is the
+// literal's sign, so widening sign-extends: -1 stays -1, 200 stays 200.
+static llvm::Value* coerceLiteral(llvm::IRBuilder<>& Builder, llvm::Value* V, llvm::Type* Ty) {
+    if (V->getType() != Ty && llvm::isa<llvm::ConstantInt>(V) && Ty->isIntegerTy())
+        return Builder.CreateSExtOrTrunc(V, Ty);
+    return V;
+}
+
+// Convert an integer value to the requested integer type. Jam integers are
+// unsigned, so values zero-extend; literals keep their sign as above.
+static llvm::Value* castToType(llvm::IRBuilder<>& Builder, llvm::Value* V, llvm::Type* Ty) {
+    V = coerceLiteral(Builder, V, Ty);
+    if (V->getType() == Ty)
+        return V;
+    if (V->getType()->isIntegerTy() && Ty->isIntegerTy())
+        return Builder.CreateIntCast(V, Ty, false, "cast");
+    throw std::runtime_error("Type mismatch in error union value");
+}
+
+// Build an error union { value, error_code }
+static llvm::Value* makeErrorUnion(llvm::IRBuilder<>& Builder, llvm::Type* UnionType, llvm::Value* Payload, llvm::Value* Code) {
+    llvm::Value* Union = llvm::UndefValue::get(UnionType);
+    Union = Builder.CreateInsertValue(Union, Payload, 0);
+    return Builder.CreateInsertValue(Union, Code, 1);
+}
+
+// Branch weights for an "is error" check: errors are expected to be rare, so
+// the error path is laid out cold and away from the fall-through hot path
+static llvm::MDNode* getErrorBranchWeights(llvm::LLVMContext& Context) {
+    return llvm::MDBuilder(Context).createBranchWeights(1, 2000);
+}
 
 llvm::Value* NumberExprAST::codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) {
-    // Choose appropriate type based on value range
+    // Choose the smallest type that holds the value as a signed integer, so
+    // the sign bit tells a negative literal from a large one (see coerceLiteral)
     llvm::Type* IntType;
-    if (Val >= 0 && Val <= 255) {
-        IntType = llvm::Type::getInt8Ty(TheModule->getContext());
-    } else if (Val >= -128 && Val < 0) {
+    if (Val >= -128 && Val <= 127) {
         IntType = llvm::Type::getInt8Ty(TheModule->getContext());
-    } else if (Val >= 0 && Val <= 65535) {
+    } else if (Val >= -32768 && Val <= 32767) {
         IntType = llvm::Type::getInt16Ty(TheModule->getContext());
-    } else if (Val >= -32768 && Val < 0) {
-        IntType = llvm::Type::getInt16Ty(TheModule->getContext());
-    } else if (Val >= 0 && Val <= 4294967295ULL) {
-        IntType = llvm::Type::getInt32Ty(TheModule->getContext());
-    } else if (Val >= -2147483648LL && Val < 0) {
+    } else if (Val >= -2147483648LL && Val <= 2147483647LL) {
         IntType = llvm::Type::getInt32Ty(TheModule->getContext());
     } else {
         IntType = llvm::Type::getInt64Ty(TheModule->getContext());
@@ -56,7 +96,7 @@ llvm::Value* StringLiteralExprAST::codegen(llvm::IRBuilder<>& Builder, llvm::Mod
     
     // Create a string slice struct { ptr: *u8, len: usize }
     llvm::Type* i8PtrType = llvm::PointerType::get(llvm::Type::getInt8Ty(TheModule->getContext()), 0);
-    llvm::Type* usizeType = llvm::Type::getInt64Ty(TheModule->getContext());
+    llvm::Type* usizeType = getUsizeType(TheModule->getContext());
     llvm::Type* sliceType = llvm::StructType::get(TheModule->getContext(), {i8PtrType, usizeType});
     
     // Get pointer to the string data
@@ -70,6 +110,26 @@ llvm::Value* StringLiteralExprAST::codegen(llvm::IRBuilder<>& Builder, llvm::Mod
     return SliceStruct;
 }
 
+llvm::Value* TargetConstantExprAST::codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) {
+    if (!CodegenTarget || !CodegenCPU)
+        throw std::runtime_error("@target." + Name + " used without a codegen target");
+
+    // Folded to literals, so they behave exactly like constants written in the source
+    if (Name == "cache_line") {
+        return NumberExprAST(CodegenTarget->getCacheLineSize()).codegen(Builder, TheModule, NamedValues);
+    } else if (Name == "vector_bits") {
+        return NumberExprAST(CodegenCPU->getVectorBits(*CodegenTarget)).codegen(Builder, TheModule, NamedValues);
+    } else if (Name == "pointer_size") {
+        return NumberExprAST(CodegenTarget->getPointerSize()).codegen(Builder, TheModule, NamedValues);
+    } else if (Name == "arch") {
+        return StringLiteralExprAST(CodegenTarget->getArchName()).codegen(Builder, TheModule, NamedValues);
+    } else if (Name == "os") {
+        return StringLiteralExprAST(CodegenTarget->getOSName()).codegen(Builder, TheModule, NamedValues);
+    }
+
+    throw std::runtime_error("Unknown target constant: @target." + Name);
+}
+
 llvm::Value* VariableExprAST::codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) {
     llvm::Value* V = NamedValues[Name];
     if (!V)
@@ -81,6 +141,36 @@ llvm::Value* VariableExprAST::codegen(llvm::IRBuilder<>& Builder, llvm::Module*
     return Builder.CreateLoad(LoadType, V, Name.c_str());
 }
 
+llvm::Value* FieldAccessExprAST::codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) {
+    llvm::Value* V = NamedValues[VarName];
+    if (!V)
+        throw std::runtime_error("Unknown variable name: " + VarName);
+    if (!CurrentLayouts)
+        throw std::runtime_error("No type layouts available for field access");
+
+    llvm::AllocaInst* Alloca = llvm::cast<llvm::AllocaInst>(V);
+    llvm::Type* CurType = Alloca->getAllocatedType();
+    llvm::Value* Ptr = Alloca;
+
+    // Walk the field path using the physical (possibly reordered) field indices
+    for (const auto& Field : Fields) {
+        llvm::StructType* StructTy = llvm::dyn_cast<llvm::StructType>(CurType);
+        const jam::StructLayout* Layout = (StructTy && StructTy->hasName()) ?
+            CurrentLayouts->lookup(StructTy->getName().str()) : nullptr;
+        if (!Layout)
+            throw std::runtime_error("Field access on non-struct value: " + VarName + "." + Field);
+
+        int Idx = Layout->getFieldIndex(Field);
+        if (Idx < 0)
+            throw std::runtime_error("Struct " + Layout->name + " has no field named " + Field);
+
+        Ptr = Builder.CreateStructGEP(StructTy, Ptr, Idx, Field + "_ptr");
+        CurType = StructTy->getElementType(Idx);
+    }
+
+    return Builder.CreateLoad(CurType, Ptr, Fields.back().c_str());
+}
+
 llvm::Value* BinaryExprAST::codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) {
     llvm::Value* L = LHS->codegen(Builder, TheModule, NamedValues);
     llvm::Value* R = RHS->codegen(Builder, TheModule, NamedValues);
@@ -88,6 +178,9 @@ llvm::Value* BinaryExprAST::codegen(llvm::IRBuilder<>& Builder, llvm::Module* Th
     if (!L || !R)
         return nullptr;
 
+    L = coerceLiteral(Builder, L, R->getType());
+    R = coerceLiteral(Builder, R, L->getType());
+
     if (Op == "+")
         return Builder.CreateAdd(L, R, "addtmp");
     else if (Op == "==")
@@ -108,11 +201,23 @@ llvm::Value* BinaryExprAST::codegen(llvm::IRBuilder<>& Builder, llvm::Module* Th
 
 llvm::Value* CallExprAST::codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) {
     // Handle built-in print functions
-    if (Callee == "print" || Callee == "println" || Callee == "printf") {
+    if (isPrintCall()) {
         return generatePrintCall(Builder, TheModule, NamedValues);
     }
     
     llvm::Function* CalleeF = TheModule->getFunction(Callee);
+    if (!CalleeF && CurrentPrototypes) {
+        auto Proto = CurrentPrototypes->find(Callee);
+        // The prototype carries the symbol name, which may be renamed and
+        // already defined in this module
+        if (Proto != CurrentPrototypes->end()) {
+            CalleeF = TheModule->getFunction(Proto->second->Name);
+        }
+        if (Proto != CurrentPrototypes->end() && !CalleeF) {
+            FunctionAST Decl(Proto->second->Name, Proto->second->Args, Proto->second->ReturnType, {}, /*isExtern=*/true);
+            CalleeF = Decl.codegen(Builder, TheModule, NamedValues);
+        }
+    }
     if (!CalleeF)
         throw std::runtime_error("Unknown function referenced: " + Callee);
 
@@ -124,6 +229,7 @@ llvm::Value* CallExprAST::codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheM
         ArgsV.push_back(Args[i]->codegen(Builder, TheModule, NamedValues));
         if (!ArgsV.back())
             return nullptr;
+        ArgsV.back() = coerceLiteral(Builder, ArgsV.back(), CalleeF->getArg(i)->getType());
     }
 
     return Builder.CreateCall(CalleeF, ArgsV, "calltmp");
@@ -213,10 +319,97 @@ llvm::Value* ReturnExprAST::codegen(llvm::IRBuilder<>& Builder, llvm::Module* Th
     if (!RetVal)
         return nullptr;
 
+    // Returning a plain value from an error union function: { value, 0 }
+    llvm::Type* FnRetType = Builder.GetInsertBlock()->getParent()->getReturnType();
+    if (isErrorUnionType(FnRetType) && RetVal->getType() != FnRetType) {
+        llvm::Type* PayloadType = llvm::cast<llvm::StructType>(FnRetType)->getElementType(0);
+        RetVal = makeErrorUnion(Builder, FnRetType, castToType(Builder, RetVal, PayloadType),
+                                llvm::ConstantInt::get(llvm::Type::getInt16Ty(TheModule->getContext()), 0));
+    }
+    RetVal = coerceLiteral(Builder, RetVal, FnRetType);
+
     Builder.CreateRet(RetVal);
     return RetVal;
 }
 
+llvm::Value* ErrorExprAST::codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) {
+    llvm::Type* FnRetType = Builder.GetInsertBlock()->getParent()->getReturnType();
+    if (!isErrorUnionType(FnRetType))
+        throw std::runtime_error("error() used in a function that does not return an error union");
+
+    llvm::Value* CodeV = Code->codegen(Builder, TheModule, NamedValues);
+    if (!CodeV)
+        return nullptr;
+    if (llvm::ConstantInt* C = llvm::dyn_cast<llvm::ConstantInt>(CodeV)) {
+        if (C->isZero())
+            throw std::runtime_error("error code 0 is reserved for success");
+    }
+    CodeV = Builder.CreateIntCast(CodeV, llvm::Type::getInt16Ty(TheModule->getContext()), false, "err_code");
+
+    llvm::Type* PayloadType = llvm::cast<llvm::StructType>(FnRetType)->getElementType(0);
+    return makeErrorUnion(Builder, FnRetType, llvm::Constant::getNullValue(PayloadType), CodeV);
+}
+
+llvm::Value* TryExprAST::codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) {
+    llvm::Value* Union = Operand->codegen(Builder, TheModule, NamedValues);
+    if (!Union)
+        return nullptr;
+    if (!isErrorUnionType(Union->getType()))
+        throw std::runtime_error("try requires an error union operand");
+
+    llvm::Function* TheFunction = Builder.GetInsertBlock()->getParent();
+    llvm::Type* FnRetType = TheFunction->getReturnType();
+    if (!isErrorUnionType(FnRetType))
+        throw std::runtime_error("try used in a function that does not return an error union");
+
+    llvm::Value* CodeV = Builder.CreateExtractValue(Union, 1, "err_code");
+    llvm::Value* IsErr = Builder.CreateICmpNE(CodeV, llvm::ConstantInt::get(CodeV->getType(), 0), "is_err");
+
+    llvm::BasicBlock* ErrBB = llvm::BasicBlock::Create(TheModule->getContext(), "try.err", TheFunction);
+    llvm::BasicBlock* OkBB = llvm::BasicBlock::Create(TheModule->getContext(), "try.ok", TheFunction);
+    Builder.CreateCondBr(IsErr, ErrBB, OkBB, getErrorBranchWeights(TheModule->getContext()));
+
+    // Propagate the error code to our caller
+    Builder.SetInsertPoint(ErrBB);
+    llvm::Type* PayloadType = llvm::cast<llvm::StructType>(FnRetType)->getElementType(0);
+    Builder.CreateRet(makeErrorUnion(Builder, FnRetType, llvm::Constant::getNullValue(PayloadType), CodeV));
+
+    Builder.SetInsertPoint(OkBB);
+    return Builder.CreateExtractValue(Union, 0, "try_val");
+}
+
+llvm::Value* CatchExprAST::codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) {
+    llvm::Value* Union = Operand->codegen(Builder, TheModule, NamedValues);
+    if (!Union)
+        return nullptr;
+    if (!isErrorUnionType(Union->getType()))
+        throw std::runtime_error("catch requires an error union operand");
+
+    llvm::Function* TheFunction = Builder.GetInsertBlock()->getParent();
+    llvm::Value* OkV = Builder.CreateExtractValue(Union, 0, "catch_val");
+    llvm::Value* CodeV = Builder.CreateExtractValue(Union, 1, "err_code");
+    llvm::Value* IsErr = Builder.CreateICmpNE(CodeV, llvm::ConstantInt::get(CodeV->getType(), 0), "is_err");
+
+    llvm::BasicBlock* OkBB = Builder.GetInsertBlock();
+    llvm::BasicBlock* ErrBB = llvm::BasicBlock::Create(TheModule->getContext(), "catch.err", TheFunction);
+    llvm::BasicBlock* MergeBB = llvm::BasicBlock::Create(TheModule->getContext(), "catch.cont", TheFunction);
+    Builder.CreateCondBr(IsErr, ErrBB, MergeBB, getErrorBranchWeights(TheModule->getContext()));
+
+    Builder.SetInsertPoint(ErrBB);
+    llvm::Value* FallbackV = Fallback->codegen(Builder, TheModule, NamedValues);
+    if (!FallbackV)
+        return nullptr;
+    FallbackV = castToType(Builder, FallbackV, OkV->getType());
+    ErrBB = Builder.GetInsertBlock();
+    Builder.CreateBr(MergeBB);
+
+    Builder.SetInsertPoint(MergeBB);
+    llvm::PHINode* PN = Builder.CreatePHI(OkV->getType(), 2, "catchtmp");
+    PN->addIncoming(OkV, OkBB);
+    PN->addIncoming(FallbackV, ErrBB);
+    return PN;
+}
+
 llvm::Value* VarDeclAST::codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) {
     llvm::Type* VarType = getTypeFromString(Type, TheModule->getContext());
     llvm::AllocaInst* Alloca = Builder.CreateAlloca(VarType, nullptr, Name);
@@ -225,7 +418,7 @@ llvm::Value* VarDeclAST::codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheMo
         llvm::Value* InitVal = Init->codegen(Builder, TheModule, NamedValues);
         if (!InitVal)
             return nullptr;
-        Builder.CreateStore(InitVal, Alloca);
+        Builder.CreateStore(coerceLiteral(Builder, InitVal, VarType), Alloca);
     } else {
         // Initialize with zero/null value
         llvm::Value* ZeroVal = llvm::Constant::getNullValue(VarType);
@@ -353,7 +546,7 @@ llvm::Value* ForExprAST::codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheMo
     // Convert end value to match start value type if needed
     if (EndVal->getType() != VarType) {
         if (VarType->isIntegerTy() && EndVal->getType()->isIntegerTy()) {
-            EndVal = Builder.CreateIntCast(EndVal, VarType, true, "endcast");
+            EndVal = Builder.CreateIntCast(coerceLiteral(Builder, EndVal, VarType), VarType, false, "endcast");
         } else {
             throw std::runtime_error("Type mismatch in for loop range");
         }
@@ -443,7 +636,24 @@ llvm::Value* ContinueExprAST::codegen(llvm::IRBuilder<>& Builder, llvm::Module*
     return llvm::ConstantInt::get(llvm::Type::getInt8Ty(TheModule->getContext()), 0);
 }
 
+llvm::StructType* StructAST::codegen(llvm::Module* TheModule, jam::LayoutEngine& Layouts) {
+    const jam::StructLayout& Layout = Layouts.addStruct(Name, Fields, isExtern);
+
+    // Build the LLVM type in memory order; natural alignment matches the computed offsets
+    std::vector<llvm::Type*> ElemTypes;
+    for (const auto& Field : Layout.fields) {
+        ElemTypes.push_back(getTypeFromString(Field.type, TheModule->getContext()));
+    }
+
+    return llvm::StructType::create(TheModule->getContext(), ElemTypes, Name);
+}
+
 llvm::Function* FunctionAST::codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) {
+    // Declarations are not counted as generated functions
+    std::optional<jam::TimeScope> Timing;
+    if (!isExtern)
+        Timing.emplace("Codegen", Name);
+
     // Create function prototype
     std::vector<llvm::Type*> ArgTypes;
     for (const auto& arg : Args) {
@@ -481,6 +691,16 @@ llvm::Function* FunctionAST::codegen(llvm::IRBuilder<>& Builder, llvm::Module* T
         F->setCallingConv(llvm::CallingConv::C);
     }
 
+    // Errors travel in the return value, so no unwind tables are needed
+    if (isErrorUnionType(RetType)) {
+        F->addFnAttr(llvm::Attribute::NoUnwind);
+    }
+
+    // Multiversioned functions are cloned per ISA by jam::lowerTargetClones
+    if (!TargetClones.empty()) {
+        jam::setTargetClones(F, TargetClones);
+    }
+
     // Set names for all arguments
     unsigned ArgIdx = 0;
     for (auto& Arg : F->args())
@@ -521,6 +741,16 @@ llvm::Function* FunctionAST::codegen(llvm::IRBuilder<>& Builder, llvm::Module* T
         Builder.CreateRetVoid();
     }
 
+    // A non-void function may only end in a block control can't reach, such
+    // as the merge block after an if/else whose branches both returned;
+    // close it so passes see valid IR. Any other way off the end is an error.
+    llvm::BasicBlock* LastBB = Builder.GetInsertBlock();
+    if (!LastBB->getTerminator()) {
+        if (llvm::is_contained(llvm::depth_first(&F->getEntryBlock()), LastBB))
+            throw std::runtime_error("non-void function " + Name + " does not return a value on all paths");
+        Builder.CreateUnreachable();
+    }
+
     // Validate the generated code, checking for consistency
     llvm::verifyFunction(*F);
 
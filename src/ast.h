@@ -17,15 +17,29 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Value.h"
 
+#include "layout.h"
+
 // Forward declarations
 class ExprAST;
 class FunctionAST;
 
+namespace jam {
+class BytecodeCompiler;
+struct BCValue;
+class InterfaceWriter;
+}
+
 // AST node base class
 class ExprAST {
 public:
     virtual ~ExprAST() = default;
     virtual llvm::Value* codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) = 0;
+
+    // --interp: compile to bytecode instead of IR (bytecode.cpp)
+    virtual jam::BCValue emitBytecode(jam::BytecodeCompiler& C) = 0;
+
+    // jam build: write the node into a module interface (interface.cpp)
+    virtual void serialize(jam::InterfaceWriter& W) const = 0;
 };
 
 // Number literal
@@ -34,6 +48,8 @@ class NumberExprAST : public ExprAST {
 public:
     NumberExprAST(int64_t Val) : Val(Val) {}
     llvm::Value* codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) override;
+    jam::BCValue emitBytecode(jam::BytecodeCompiler& C) override;
+    void serialize(jam::InterfaceWriter& W) const override;
 };
 
 // Boolean literal
@@ -42,6 +58,8 @@ class BooleanExprAST : public ExprAST {
 public:
     BooleanExprAST(bool Val) : Val(Val) {}
     llvm::Value* codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) override;
+    jam::BCValue emitBytecode(jam::BytecodeCompiler& C) override;
+    void serialize(jam::InterfaceWriter& W) const override;
 };
 
 // String literal
@@ -50,6 +68,19 @@ class StringLiteralExprAST : public ExprAST {
 public:
     StringLiteralExprAST(std::string Val) : Val(std::move(Val)) {}
     llvm::Value* codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) override;
+    jam::BCValue emitBytecode(jam::BytecodeCompiler& C) override;
+    void serialize(jam::InterfaceWriter& W) const override;
+};
+
+// Target constant known at compile time: @target.cache_line, @target.vector_bits,
+// @target.pointer_size, @target.arch, @target.os
+class TargetConstantExprAST : public ExprAST {
+    std::string Name;
+public:
+    TargetConstantExprAST(std::string Name) : Name(std::move(Name)) {}
+    llvm::Value* codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) override;
+    jam::BCValue emitBytecode(jam::BytecodeCompiler& C) override;
+    void serialize(jam::InterfaceWriter& W) const override;
 };
 
 // Variable reference
@@ -58,6 +89,20 @@ class VariableExprAST : public ExprAST {
 public:
     VariableExprAST(std::string Name) : Name(std::move(Name)) {}
     llvm::Value* codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) override;
+    jam::BCValue emitBytecode(jam::BytecodeCompiler& C) override;
+    void serialize(jam::InterfaceWriter& W) const override;
+};
+
+// Struct field access (e.g. p.x or rect.top_left.y)
+class FieldAccessExprAST : public ExprAST {
+    std::string VarName;
+    std::vector<std::string> Fields;
+public:
+    FieldAccessExprAST(std::string VarName, std::vector<std::string> Fields)
+        : VarName(std::move(VarName)), Fields(std::move(Fields)) {}
+    llvm::Value* codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) override;
+    jam::BCValue emitBytecode(jam::BytecodeCompiler& C) override;
+    void serialize(jam::InterfaceWriter& W) const override;
 };
 
 // Binary operation
@@ -68,6 +113,8 @@ public:
     BinaryExprAST(std::string Op, std::unique_ptr<ExprAST> LHS, std::unique_ptr<ExprAST> RHS)
         : Op(std::move(Op)), LHS(std::move(LHS)), RHS(std::move(RHS)) {}
     llvm::Value* codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) override;
+    jam::BCValue emitBytecode(jam::BytecodeCompiler& C) override;
+    void serialize(jam::InterfaceWriter& W) const override;
 };
 
 // Function call
@@ -78,6 +125,11 @@ public:
     CallExprAST(std::string Callee, std::vector<std::unique_ptr<ExprAST>> Args)
         : Callee(std::move(Callee)), Args(std::move(Args)) {}
     llvm::Value* codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) override;
+    jam::BCValue emitBytecode(jam::BytecodeCompiler& C) override;
+    void serialize(jam::InterfaceWriter& W) const override;
+
+    // print, println and printf are built in
+    bool isPrintCall() const { return Callee == "print" || Callee == "println" || Callee == "printf"; }
     
 private:
     llvm::Value* generatePrintCall(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues);
@@ -89,6 +141,40 @@ class ReturnExprAST : public ExprAST {
 public:
     ReturnExprAST(std::unique_ptr<ExprAST> RetVal) : RetVal(std::move(RetVal)) {}
     llvm::Value* codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) override;
+    jam::BCValue emitBytecode(jam::BytecodeCompiler& C) override;
+    void serialize(jam::InterfaceWriter& W) const override;
+};
+
+// Error value for a function returning an error union: error(code)
+class ErrorExprAST : public ExprAST {
+    std::unique_ptr<ExprAST> Code;
+public:
+    ErrorExprAST(std::unique_ptr<ExprAST> Code) : Code(std::move(Code)) {}
+    llvm::Value* codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) override;
+    jam::BCValue emitBytecode(jam::BytecodeCompiler& C) override;
+    void serialize(jam::InterfaceWriter& W) const override;
+};
+
+// try expr: unwrap an error union, propagating the error to the caller
+class TryExprAST : public ExprAST {
+    std::unique_ptr<ExprAST> Operand;
+public:
+    TryExprAST(std::unique_ptr<ExprAST> Operand) : Operand(std::move(Operand)) {}
+    llvm::Value* codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) override;
+    jam::BCValue emitBytecode(jam::BytecodeCompiler& C) override;
+    void serialize(jam::InterfaceWriter& W) const override;
+};
+
+// expr catch fallback: unwrap an error union, using fallback on error
+class CatchExprAST : public ExprAST {
+    std::unique_ptr<ExprAST> Operand;
+    std::unique_ptr<ExprAST> Fallback;
+public:
+    CatchExprAST(std::unique_ptr<ExprAST> Operand, std::unique_ptr<ExprAST> Fallback)
+        : Operand(std::move(Operand)), Fallback(std::move(Fallback)) {}
+    llvm::Value* codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) override;
+    jam::BCValue emitBytecode(jam::BytecodeCompiler& C) override;
+    void serialize(jam::InterfaceWriter& W) const override;
 };
 
 // Variable declaration
@@ -101,6 +187,8 @@ public:
     VarDeclAST(std::string Name, std::string Type, bool IsConst, std::unique_ptr<ExprAST> Init)
         : Name(std::move(Name)), Type(std::move(Type)), IsConst(IsConst), Init(std::move(Init)) {}
     llvm::Value* codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) override;
+    jam::BCValue emitBytecode(jam::BytecodeCompiler& C) override;
+    void serialize(jam::InterfaceWriter& W) const override;
 };
 
 // If statement
@@ -114,6 +202,8 @@ public:
               std::vector<std::unique_ptr<ExprAST>> ElseBody)
         : Condition(std::move(Condition)), ThenBody(std::move(ThenBody)), ElseBody(std::move(ElseBody)) {}
     llvm::Value* codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) override;
+    jam::BCValue emitBytecode(jam::BytecodeCompiler& C) override;
+    void serialize(jam::InterfaceWriter& W) const override;
 };
 
 // While loop
@@ -124,6 +214,8 @@ public:
     WhileExprAST(std::unique_ptr<ExprAST> Condition, std::vector<std::unique_ptr<ExprAST>> Body)
         : Condition(std::move(Condition)), Body(std::move(Body)) {}
     llvm::Value* codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) override;
+    jam::BCValue emitBytecode(jam::BytecodeCompiler& C) override;
+    void serialize(jam::InterfaceWriter& W) const override;
 };
 
 // For loop
@@ -136,6 +228,8 @@ public:
     ForExprAST(std::string VarName, std::unique_ptr<ExprAST> Start, std::unique_ptr<ExprAST> End, std::vector<std::unique_ptr<ExprAST>> Body)
         : VarName(std::move(VarName)), Start(std::move(Start)), End(std::move(End)), Body(std::move(Body)) {}
     llvm::Value* codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) override;
+    jam::BCValue emitBytecode(jam::BytecodeCompiler& C) override;
+    void serialize(jam::InterfaceWriter& W) const override;
 };
 
 // Break statement
@@ -143,6 +237,8 @@ class BreakExprAST : public ExprAST {
 public:
     BreakExprAST() {}
     llvm::Value* codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) override;
+    jam::BCValue emitBytecode(jam::BytecodeCompiler& C) override;
+    void serialize(jam::InterfaceWriter& W) const override;
 };
 
 // Continue statement
@@ -150,6 +246,8 @@ class ContinueExprAST : public ExprAST {
 public:
     ContinueExprAST() {}
     llvm::Value* codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues) override;
+    jam::BCValue emitBytecode(jam::BytecodeCompiler& C) override;
+    void serialize(jam::InterfaceWriter& W) const override;
 };
 
 // Function declaration
@@ -161,6 +259,7 @@ public:
     std::vector<std::unique_ptr<ExprAST>> Body;
     bool isExtern;  // extern function (no body)
     bool isExport;  // export function (visible to C)
+    std::vector<std::string> TargetClones;  // @target_clones("avx2", ..., "default")
 
     FunctionAST(std::string Name, std::vector<std::pair<std::string, std::string>> Args,
                 std::string ReturnType, std::vector<std::unique_ptr<ExprAST>> Body,
@@ -171,8 +270,29 @@ public:
     llvm::Function* codegen(llvm::IRBuilder<>& Builder, llvm::Module* TheModule, std::map<std::string, llvm::Value*>& NamedValues);
 };
 
-// Global variables to track loop context for break/continue
-extern llvm::BasicBlock* CurrentLoopContinue;
-extern llvm::BasicBlock* CurrentLoopBreak;
+// Struct declaration
+class StructAST {
+public:
+    std::string Name;
+    std::vector<jam::FieldDecl> Fields;
+    bool isExtern;  // extern struct (C layout, fields keep declaration order)
+
+    StructAST(std::string Name, std::vector<jam::FieldDecl> Fields, bool isExtern = false)
+        : Name(std::move(Name)), Fields(std::move(Fields)), isExtern(isExtern) {}
+
+    llvm::StructType* codegen(llvm::Module* TheModule, jam::LayoutEngine& Layouts);
+};
+
+// Loop context for break/continue. Codegen state is per thread, so jam
+// build can generate several modules at once.
+extern thread_local llvm::BasicBlock* CurrentLoopContinue;
+extern thread_local llvm::BasicBlock* CurrentLoopBreak;
+
+// Layout engine used to resolve struct field positions
+extern thread_local jam::LayoutEngine* CurrentLayouts;
+
+// Prototypes of functions defined in other modules of a pipelined compile
+// (pipeline.cpp); a call to one of them declares it in the current module
+extern thread_local const std::map<std::string, std::unique_ptr<FunctionAST>>* CurrentPrototypes;
 
 #endif // AST_H
@@ -0,0 +1,575 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "build.h"
+#include "ast.h"
+#include "buildcache.h"
+#include "codegen.h"
+#include "interface.h"
+#include "layout.h"
+#include "lexer.h"
+#include "linker.h"
+#include "lto.h"
+#include "multiversion.h"
+#include "parser.h"
+#include "timing.h"
+#include "version.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace jam {
+
+namespace {
+
+struct BuildModule {
+    std::string path;
+    std::string source;
+    std::shared_ptr<const ModuleInterface> interface;
+    std::vector<size_t> imports;  // indices of directly imported modules
+    std::string key;              // build cache key
+    std::string objectPath;       // object, or bitcode with --lto
+    bool cached = false;
+
+    // Kept from loading when the module had to be parsed then
+    bool parsed = false;
+    std::vector<std::unique_ptr<FunctionAST>> functions;
+    std::vector<std::unique_ptr<StructAST>> structs;
+};
+
+std::string readFile(const std::string& path) {
+    TimeScope timing("Read", path);
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+// Canonical path, so a module imported under different spellings is built once
+std::string canonicalPath(const std::string& path) {
+    llvm::SmallString<256> real;
+    if (llvm::sys::fs::real_path(path, real)) {
+        throw std::runtime_error("Could not find module: " + path);
+    }
+    return std::string(real);
+}
+
+void parseModule(BuildModule& module) {
+    Lexer lexer(module.source);
+    std::vector<Token> tokens;
+    try {
+        tokens = lexer.scanTokens();
+    } catch (const std::exception& e) {
+        throw std::runtime_error(module.path + ": " + e.what());
+    }
+    Parser parser(tokens);
+    try {
+        module.functions = parser.parse();
+    } catch (const std::exception& e) {
+        throw std::runtime_error(module.path + ": " + e.what());
+    }
+    if (!parser.getCImports().empty()) {
+        throw std::runtime_error(module.path + ": @cImport is not supported by jam build");
+    }
+    module.structs = std::move(parser.getStructs());
+    module.parsed = true;
+    if (module.interface) {
+        return;
+    }
+
+    // The interface records the imports too, so a cached one is all
+    // loading needs
+    std::string bytes = ModuleInterface::write(parser.getImports(), module.structs, module.functions);
+    module.interface = ModuleInterface::read(llvm::MemoryBuffer::getMemBufferCopy(bytes, module.path + ".jami"));
+}
+
+using InterfaceMap = std::map<std::string, std::shared_ptr<const ModuleInterface>>;
+
+// Interfaces depend only on the source, so they are cached under its hash
+std::string getSourceHash(const std::string& source) {
+    return BuildCache::hash("jami " + std::to_string(ModuleInterface::Version) + ";jam " JAM_VERSION "\n" + source);
+}
+
+// Load the interface of a module, from the session or the cache if its
+// source is unchanged; record it in used
+void loadInterface(BuildModule& module, BuildCache* cache, const InterfaceMap& warm, InterfaceMap& used) {
+    std::string sourceHash = getSourceHash(module.source);
+    auto it = warm.find(sourceHash);
+    if (it != warm.end()) {
+        module.interface = used[sourceHash] = it->second;
+        return;
+    }
+    if (cache) {
+        std::string path = cache->getPath(sourceHash, ".jami");
+        if (cache->lookup(path)) {
+            auto buffer = llvm::MemoryBuffer::getFile(path, /*IsText=*/false, /*RequiresNullTerminator=*/false);
+            if (buffer) {
+                try {
+                    module.interface = used[sourceHash] = ModuleInterface::read(std::move(*buffer));
+                    return;
+                } catch (const std::exception&) {
+                    // Parse the source instead
+                }
+            }
+        }
+    }
+    parseModule(module);
+    used[sourceHash] = module.interface;
+    if (cache) {
+        cache->store(module.interface->getBytes(), cache->getPath(sourceHash, ".jami"));
+    }
+}
+
+// Load the named modules and everything they import, breadth first
+std::vector<BuildModule> loadModules(const std::vector<std::string>& roots, BuildCache* cache, const InterfaceMap& warm,
+                                     InterfaceMap& used) {
+    std::vector<BuildModule> modules;
+    std::map<std::string, size_t> indices;
+    std::deque<size_t> pending;
+
+    auto add = [&](const std::string& path) {
+        std::string key = canonicalPath(path);
+        auto it = indices.find(key);
+        if (it != indices.end()) {
+            return it->second;
+        }
+        size_t index = modules.size();
+        indices[key] = index;
+        modules.push_back({});
+        modules.back().path = path;
+        pending.push_back(index);
+        return index;
+    };
+
+    for (const auto& root : roots) {
+        add(root);
+    }
+    while (!pending.empty()) {
+        size_t index = pending.front();
+        pending.pop_front();
+        BuildModule& module = modules[index];
+        module.source = readFile(module.path);
+        loadInterface(module, cache, warm, used);
+
+        std::string path = module.path;
+        std::vector<std::string> names = module.interface->getImports();
+        std::string directory = llvm::sys::path::parent_path(path).str();
+        std::vector<size_t> imports;
+        for (const auto& name : names) {
+            llvm::SmallString<256> importPath(directory);
+            llvm::sys::path::append(importPath, name);
+            try {
+                imports.push_back(add(std::string(importPath)));
+            } catch (const std::exception&) {
+                throw std::runtime_error(path + ": cannot find import \"" + name + "\"");
+            }
+        }
+        // add() may have grown the vector
+        modules[index].imports = std::move(imports);
+    }
+    return modules;
+}
+
+// Exported names are global at link time
+void checkSymbols(const std::vector<BuildModule>& modules) {
+    std::map<std::string, size_t> exporters;
+    size_t mains = 0;
+    for (size_t i = 0; i < modules.size(); i++) {
+        if (modules[i].interface->definesMain()) {
+            mains++;
+        }
+        for (const auto& function : modules[i].interface->getExports()) {
+            auto [it, inserted] = exporters.emplace(function.name, i);
+            if (!inserted) {
+                throw std::runtime_error("export fn " + function.name + " is defined in both " +
+                                         modules[it->second].path + " and " + modules[i].path);
+            }
+        }
+    }
+    if (mains != 1) {
+        throw std::runtime_error(mains == 0 ? "no module defines main" : "more than one module defines main");
+    }
+
+    // A module sees its own structs and those of its direct imports. Inline
+    // bodies of imported functions are generated against the importer's
+    // types, so one name must mean one layout among them.
+    for (const auto& module : modules) {
+        std::map<std::string, const std::string*> definers;
+        for (const auto& structDecl : module.interface->getStructs()) {
+            definers.emplace(structDecl->Name, &module.path);
+        }
+        for (size_t imported : module.imports) {
+            for (const auto& structDecl : modules[imported].interface->getStructs()) {
+                auto [it, inserted] = definers.emplace(structDecl->Name, &modules[imported].path);
+                if (!inserted) {
+                    throw std::runtime_error("struct " + structDecl->Name + " is defined in both " + *it->second +
+                                             " and " + modules[imported].path + ", both visible in " +
+                                             module.path);
+                }
+            }
+        }
+    }
+}
+
+// Hash of the module's source, the interfaces of every module it reaches
+// through imports, and the code generation settings. Paths are left out,
+// so checkouts in different places share cache entries.
+std::string computeKey(const std::vector<BuildModule>& modules, size_t index, const std::string& salt) {
+    std::string data = salt;
+    data.push_back('\0');
+    data += modules[index].source;
+
+    std::vector<bool> seen(modules.size());
+    std::deque<size_t> pending(modules[index].imports.begin(), modules[index].imports.end());
+    seen[index] = true;
+    while (!pending.empty()) {
+        size_t imported = pending.front();
+        pending.pop_front();
+        if (seen[imported]) {
+            continue;
+        }
+        seen[imported] = true;
+        data.push_back('\0');
+        data += modules[imported].interface->getBytes();
+        pending.insert(pending.end(), modules[imported].imports.begin(), modules[imported].imports.end());
+    }
+    return BuildCache::hash(data);
+}
+
+void compileModule(BuildModule& unit, const std::vector<BuildModule>& modules, const Target& target,
+                   const BuildOptions& options, llvm::TargetMachine& targetMachine) {
+    // Modules whose interface came from the cache are parsed here, on the worker
+    if (!unit.parsed) {
+        parseModule(unit);
+    }
+
+    // A module can't define a name it imports
+    for (const auto& function : unit.functions) {
+        for (size_t imported : unit.imports) {
+            for (const auto& exported : modules[imported].interface->getExports()) {
+                if (!function->isExtern && exported.name == function->Name) {
+                    throw std::runtime_error(function->Name + " is also exported by " + modules[imported].path);
+                }
+            }
+        }
+    }
+
+    LayoutEngine layouts(target, target.getCacheLineSize());
+    CurrentLayouts = &layouts;
+    CodegenTarget = &target;
+    CodegenCPU = &options.cpu;
+
+    llvm::LLVMContext context;
+    // Names of local values only matter to someone reading unoptimized IR
+    context.setDiscardValueNames(options.optimization.level != OptLevel::O0);
+    auto module = std::make_unique<llvm::Module>(unit.path, context);
+    module->setSourceFileName(unit.path);
+    module->setTargetTriple(targetMachine.getTargetTriple().str());
+    module->setDataLayout(targetMachine.createDataLayout());
+
+    llvm::IRBuilder<> builder(context);
+    std::map<std::string, llvm::Value*> namedValues;
+
+    // Imported structs may appear in exported signatures and inline bodies;
+    // checkSymbols has ruled out a second definition of any of them
+    for (size_t imported : unit.imports) {
+        for (auto& structDecl : modules[imported].interface->getStructs()) {
+            structDecl->codegen(module.get(), layouts);
+        }
+    }
+    for (auto& structDecl : unit.structs) {
+        structDecl->codegen(module.get(), layouts);
+    }
+
+    // Only the exports of direct imports are visible
+    for (size_t imported : unit.imports) {
+        for (const auto& function : modules[imported].interface->getExports()) {
+            if (!module->getFunction(function.name)) {
+                FunctionAST decl(function.name, function.args, function.returnType, {}, /*isExtern=*/true);
+                decl.codegen(builder, module.get(), namedValues);
+            }
+        }
+    }
+
+    // When optimizing, small imported exports get their bodies as
+    // available_externally definitions: the optimizer may inline them, and
+    // calls it leaves still go to the exporting module's copy
+    if (options.optimization.level != OptLevel::O0) {
+        for (size_t imported : unit.imports) {
+            for (const auto& function : modules[imported].interface->getExports()) {
+                std::unique_ptr<FunctionAST> body = modules[imported].interface->loadInlineBody(function);
+                llvm::Function* decl = module->getFunction(function.name);
+                if (!body || !decl || !decl->isDeclaration()) {
+                    continue;
+                }
+                decl->setName("");
+                llvm::Function* definition = body->codegen(builder, module.get(), namedValues);
+                decl->replaceAllUsesWith(definition);
+                decl->eraseFromParent();
+                definition->setLinkage(llvm::GlobalValue::AvailableExternallyLinkage);
+            }
+        }
+    }
+
+    for (auto& function : unit.functions) {
+        if (function->isExtern && module->getFunction(function->Name)) {
+            continue;
+        }
+        function->codegen(builder, module.get(), namedValues);
+    }
+
+    lowerTargetClones(*module, target, /*forJIT=*/false);
+    {
+        TimeScope timing("Verify", unit.path);
+        std::string verifyErrors;
+        llvm::raw_string_ostream verifyOut(verifyErrors);
+        if (llvm::verifyModule(*module, &verifyOut)) {
+            throw std::runtime_error("generated invalid code: " + verifyOut.str());
+        }
+    }
+    optimizeModule(*module, &targetMachine, options.optimization);
+
+    TimeScope timing("Emit", unit.path);
+    if (options.optimization.lto != LTOMode::None) {
+        writeLTOBitcode(*module, options.cpu, options.optimization.lto, unit.objectPath);
+        return;
+    }
+
+    std::error_code EC;
+    llvm::raw_fd_ostream dest(unit.objectPath, EC, llvm::sys::fs::OF_None);
+    if (EC) {
+        throw std::runtime_error("Could not open file: " + EC.message());
+    }
+    llvm::legacy::PassManager pass;
+    if (targetMachine.addPassesToEmitFile(pass, dest, nullptr, llvm::CodeGenFileType::ObjectFile)) {
+        throw std::runtime_error("TargetMachine can't emit a file of this type");
+    }
+    pass.run(*module);
+}
+
+LinkJob getLinkJob(const std::vector<BuildModule>& modules, const BuildOptions& options) {
+    LinkJob job;
+    for (const auto& module : modules) {
+        job.objects.push_back(module.objectPath);
+    }
+    job.inputs = options.linkInputs;
+    job.output = options.output;
+    job.cpu = options.cpu;
+    job.optimization = options.optimization;
+    return job;
+}
+
+// Identifies one link: the module keys, the link command and the state of
+// every other input. A rebuild that matches the last one skips the link.
+std::string getLinkStamp(const std::vector<BuildModule>& modules, const BuildOptions& options) {
+    std::string data = getClangLinkCommand(getLinkJob(modules, options));
+    for (const auto& module : modules) {
+        data += "\n" + module.key;
+    }
+    for (const auto& input : options.linkInputs) {
+        llvm::sys::fs::file_status status;
+        if (llvm::sys::fs::status(input, status)) {
+            continue;
+        }
+        data += "\n" + input + " " + std::to_string(status.getSize()) + " " +
+                std::to_string(status.getLastModificationTime().time_since_epoch().count());
+    }
+    return BuildCache::hash(data);
+}
+
+} // namespace
+
+int runBuild(const Target& target, const BuildOptions& options) {
+    BuildSession session(target);
+    return session.build(options, std::cout, std::cerr);
+}
+
+BuildSession::BuildSession(const Target& target) : target_(target) {}
+
+BuildSession::~BuildSession() = default;
+
+std::unique_ptr<llvm::TargetMachine> BuildSession::acquireTargetMachine(const BuildOptions& options,
+                                                                       const std::string& salt) {
+    {
+        std::lock_guard<std::mutex> lock(machinesMutex_);
+        auto& idle = machines_[salt];
+        if (!idle.empty()) {
+            std::unique_ptr<llvm::TargetMachine> machine = std::move(idle.back());
+            idle.pop_back();
+            return machine;
+        }
+    }
+    // Every worker builds its own TargetMachine from the same configuration
+    return createTargetMachine(options.cpu, options.optimization.level);
+}
+
+void BuildSession::releaseTargetMachine(const std::string& salt, std::unique_ptr<llvm::TargetMachine> machine) {
+    std::lock_guard<std::mutex> lock(machinesMutex_);
+    machines_[salt].push_back(std::move(machine));
+}
+
+int BuildSession::build(const BuildOptions& options, std::ostream& out, std::ostream& err) {
+    BuildCache* cache = nullptr;
+    std::string cacheDirectory = options.cacheDirectory.empty() ? BuildCache::getDefaultDirectory()
+                                                                : options.cacheDirectory;
+    if (options.useCache && !cacheDirectory.empty()) {
+        auto& open = caches_[cacheDirectory];
+        if (!open) {
+            open = std::make_unique<BuildCache>(cacheDirectory, BuildCache::DefaultMaxBytes, options.verbose);
+        }
+        cache = open.get();
+    }
+
+    std::vector<BuildModule> modules;
+    InterfaceMap used;
+    try {
+        modules = loadModules(options.modules, cache, interfaces_, used);
+        checkSymbols(modules);
+    } catch (const std::exception& e) {
+        err << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    // Keeps the session's memory bounded by the program being built
+    interfaces_ = std::move(used);
+
+    // Unchanged modules are linked straight from the cache
+    std::string extension = options.optimization.lto != LTOMode::None ? ".bc" : ".o";
+    std::string salt = BuildCache::getSalt(options.cpu, options.optimization);
+    std::vector<size_t> stale;
+    llvm::sys::fs::create_directories(options.objectDirectory);
+    for (size_t i = 0; i < modules.size(); i++) {
+        BuildModule& module = modules[i];
+        llvm::SmallString<256> path(options.objectDirectory);
+        llvm::sys::path::append(path, std::to_string(i) + "-" + llvm::sys::path::stem(module.path).str());
+
+        // The interface goes next to the object whether or not the cache is
+        // on, for tools that read a build's interfaces
+        std::error_code EC;
+        llvm::raw_fd_ostream interfaceFile(std::string(path) + ".jami", EC, llvm::sys::fs::OF_None);
+        if (EC) {
+            err << "Error: Could not open file: " << EC.message() << std::endl;
+            return 1;
+        }
+        interfaceFile << module.interface->getBytes();
+
+        if (cache) {
+            module.key = computeKey(modules, i, salt);
+            std::string cachedPath = cache->getPath(module.key, extension);
+            if (cache->lookup(cachedPath)) {
+                module.objectPath = cachedPath;
+                module.cached = true;
+                if (options.verbose) {
+                    err << "[build-cache] hit: " << module.path << std::endl;
+                }
+                continue;
+            }
+            if (options.verbose) {
+                err << "[build-cache] miss: " << module.path << std::endl;
+            }
+        }
+        module.objectPath = std::string(path) + extension;
+        stale.push_back(i);
+    }
+
+    // Modules depend on each other only through parsed declarations, so all
+    // of them can be compiled at once
+    unsigned jobs = options.jobs ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+    jobs = std::min<unsigned>(jobs, stale.size());
+    std::atomic<size_t> next = 0;
+    std::mutex errorMutex;
+    std::vector<std::string> errors;
+
+    auto worker = [&] {
+        for (size_t n = next++; n < stale.size(); n = next++) {
+            BuildModule& module = modules[stale[n]];
+            try {
+                std::unique_ptr<llvm::TargetMachine> machine = acquireTargetMachine(options, salt);
+                compileModule(module, modules, target_, options, *machine);
+                releaseTargetMachine(salt, std::move(machine));
+                if (cache) {
+                    cache->insert(module.objectPath, cache->getPath(module.key, extension));
+                }
+            } catch (const std::exception& e) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                errors.push_back(module.path + ": " + e.what());
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < jobs; i++) {
+        threads.emplace_back([&] {
+            startTimingThread();
+            worker();
+            finishTimingThread();
+        });
+    }
+    if (!stale.empty()) {
+        worker();
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (!errors.empty()) {
+        for (const auto& error : errors) {
+            err << "Error: " << error << std::endl;
+        }
+        return 1;
+    }
+
+    size_t cached = modules.size() - stale.size();
+    llvm::SmallString<256> stampPath(options.objectDirectory);
+    // One stamp per executable, so alternating builds don't invalidate each other
+    llvm::sys::path::append(stampPath, "link-" + BuildCache::hash(options.output).substr(0, 16) + ".stamp");
+    std::string stamp = cache ? getLinkStamp(modules, options) : "";
+    if (cache && stale.empty() && llvm::sys::fs::exists(options.output)) {
+        std::ifstream previous{std::string(stampPath)};
+        std::string previousStamp;
+        if (std::getline(previous, previousStamp) && previousStamp == stamp) {
+            out << options.output << " is up to date (" << modules.size() << " modules)." << std::endl;
+            return 0;
+        }
+    }
+
+    llvm::sys::fs::remove(stampPath);
+    if (!linkExecutable(getLinkJob(modules, options), target_, err, options.verbose)) {
+        err << "Error: linking failed" << std::endl;
+        return 1;
+    }
+    if (cache) {
+        std::ofstream{std::string(stampPath)} << stamp << "\n";
+    }
+
+    out << "Built " << options.output << " from " << modules.size() << " modules";
+    if (cache) {
+        out << " (" << cached << " cached)";
+    }
+    out << "." << std::endl;
+    return 0;
+}
+
+} // namespace jam
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef BUILD_H
+#define BUILD_H
+
+#include "optimizer.h"
+#include "target.h"
+#include "llvm/Target/TargetMachine.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace jam {
+
+class BuildCache;
+class ModuleInterface;
+
+struct BuildOptions {
+    std::vector<std::string> modules;     // .jam files named on the command line
+    std::vector<std::string> linkInputs;  // C sources, objects and archives
+    std::string output = "output";
+    std::string objectDirectory = "jam-build";
+    unsigned jobs = 0;                    // 0: one per hardware thread
+    CPUModel cpu;
+    OptimizationOptions optimization;
+    bool useCache = true;
+    std::string cacheDirectory;           // empty: BuildCache::getDefaultDirectory()
+    bool verbose = false;                 // report cache hits and misses
+};
+
+// jam build: compile a program made of several modules and link it.
+//
+// Starting from the named modules, every `import "path.jam";` is resolved
+// relative to the importing file and added to the build. A module sees the
+// `export fn`s of the modules it imports directly; its other functions are
+// internal to it, so two modules can each have their own private helper of
+// the same name.
+//
+// A module only needs the declarations of its imports, which come from
+// parsing, so once every module is parsed all of them are generated,
+// optimized and emitted in parallel, on `jobs` threads, each with its own
+// LLVMContext and a TargetMachine built from the same configuration. The
+// objects are then linked by linkExecutable. Returns the exit status.
+//
+// Each module's object is kept in the build cache under a hash of its
+// source, the interfaces (structs and export fn signatures) of everything
+// it imports, directly or not, and the code generation settings. Editing a
+// function body therefore recompiles only that module, and a build where
+// nothing changed compiles nothing and, if the executable is already linked
+// from the same objects, doesn't link either. With --lto the cache holds
+// the optimized bitcode and the linker generates code.
+int runBuild(const Target& target, const BuildOptions& options);
+
+// What one build leaves behind for the next: the open caches, the decoded
+// interfaces of the modules it loaded, and idle TargetMachines. runBuild
+// uses a fresh session; the compile server keeps one for its lifetime, so
+// a build only pays for the modules that changed.
+class BuildSession {
+public:
+    explicit BuildSession(const Target& target);
+    ~BuildSession();
+
+    // Build as runBuild does, reporting to out and err. One build at a time.
+    int build(const BuildOptions& options, std::ostream& out, std::ostream& err);
+
+private:
+    Target target_;
+    std::map<std::string, std::unique_ptr<BuildCache>> caches_;  // by directory
+    // Interfaces used by the last build, by source hash
+    std::map<std::string, std::shared_ptr<const ModuleInterface>> interfaces_;
+    // Idle TargetMachines, by code generation settings; workers take one each
+    std::mutex machinesMutex_;
+    std::map<std::string, std::vector<std::unique_ptr<llvm::TargetMachine>>> machines_;
+
+    std::unique_ptr<llvm::TargetMachine> acquireTargetMachine(const BuildOptions& options, const std::string& salt);
+    void releaseTargetMachine(const std::string& salt, std::unique_ptr<llvm::TargetMachine> machine);
+};
+
+} // namespace jam
+
+#endif // BUILD_H
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "buildcache.h"
+#include "jitcache.h"
+#include "version.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA256.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/TargetParser/Host.h"
+
+namespace jam {
+
+BuildCache::BuildCache(std::string directory, uint64_t maxBytes, bool verbose)
+    : directory_(std::move(directory)), maxBytes_(maxBytes), verbose_(verbose) {
+    llvm::sys::fs::create_directories(directory_);
+}
+
+std::string BuildCache::getDefaultDirectory() {
+    std::string jitDirectory = JITCache::getDefaultDirectory();
+    if (jitDirectory.empty()) {
+        return "";
+    }
+    llvm::SmallString<256> path(jitDirectory);
+    llvm::sys::path::append(path, "build");
+    return std::string(path);
+}
+
+std::string BuildCache::getSalt(const CPUModel& cpu, const OptimizationOptions& options) {
+    std::string lto = options.lto == LTOMode::None ? "none" : getLTOModeName(options.lto);
+    return llvm::sys::getDefaultTargetTriple() + ";" + cpu.name + ";" + cpu.features + ";O" +
+           std::to_string(static_cast<int>(options.level)) + ";lto " + lto + ";jam " JAM_VERSION
+           ";llvm " LLVM_VERSION_STRING;
+}
+
+std::string BuildCache::hash(llvm::StringRef data) {
+    return llvm::toHex(llvm::SHA256::hash(llvm::arrayRefFromStringRef(data)), /*LowerCase=*/true);
+}
+
+std::string BuildCache::getPath(const std::string& key, const std::string& extension) const {
+    llvm::SmallString<256> path(directory_);
+    llvm::sys::path::append(path, key + extension);
+    return std::string(path);
+}
+
+bool BuildCache::lookup(const std::string& path) {
+    if (!llvm::sys::fs::exists(path)) {
+        return false;
+    }
+    touchCacheFile(path);
+    return true;
+}
+
+void BuildCache::insert(const std::string& file, const std::string& path) {
+    // Copy to a unique name and rename, so no build ever sees a partial entry
+    int fd;
+    llvm::SmallString<256> tempPath;
+    if (llvm::sys::fs::createUniqueFile(path + ".tmp-%%%%%%", fd, tempPath)) {
+        return;
+    }
+    llvm::sys::fs::closeFile(fd);
+    if (llvm::sys::fs::copy_file(file, tempPath) || llvm::sys::fs::rename(tempPath, path)) {
+        llvm::sys::fs::remove(tempPath);
+        return;
+    }
+
+    evictCacheFiles(directory_, llvm::sys::path::extension(path).str(), maxBytes_, "build-cache", verbose_);
+}
+
+void BuildCache::store(llvm::StringRef data, const std::string& path) {
+    int fd;
+    llvm::SmallString<256> tempPath;
+    if (llvm::sys::fs::createUniqueFile(path + ".tmp-%%%%%%", fd, tempPath)) {
+        return;
+    }
+    {
+        llvm::raw_fd_ostream out(fd, /*shouldClose=*/true);
+        out << data;
+    }
+    if (llvm::sys::fs::rename(tempPath, path)) {
+        llvm::sys::fs::remove(tempPath);
+        return;
+    }
+
+    evictCacheFiles(directory_, llvm::sys::path::extension(path).str(), maxBytes_, "build-cache", verbose_);
+}
+
+} // namespace jam
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef BUILDCACHE_H
+#define BUILDCACHE_H
+
+#include "optimizer.h"
+#include "target.h"
+#include "llvm/ADT/StringRef.h"
+#include <cstdint>
+#include <string>
+
+namespace jam {
+
+// Content-addressed store of the objects (or, with --lto, the optimized
+// bitcode) and module interfaces (.jami) jam build produces for each module.
+//
+// The caller derives a key from everything that determines a module's
+// output: its source, the interfaces of the modules it imports, and the
+// salt below. Entries are only ever added by renaming a finished file into
+// place, so several builds, on one host or on several hosts sharing the
+// directory over a network filesystem, can use the same cache at once.
+// Least recently used entries are evicted once the entries of one kind
+// (objects, bitcode or interfaces) in the directory exceed maxBytes.
+class BuildCache {
+public:
+    static constexpr uint64_t DefaultMaxBytes = 1024ull * 1024 * 1024;
+
+    BuildCache(std::string directory, uint64_t maxBytes = DefaultMaxBytes, bool verbose = false);
+
+    // build/ below the JIT cache directory, usually ~/.cache/jam/build
+    static std::string getDefaultDirectory();
+
+    // Everything besides the sources that affects code generation: target
+    // triple, CPU, features, optimization level, LTO mode, jam and LLVM
+    // versions
+    static std::string getSalt(const CPUModel& cpu, const OptimizationOptions& options);
+
+    // Lowercase hex SHA-256 of data
+    static std::string hash(llvm::StringRef data);
+
+    // Path of the entry for key; extension is ".o" or ".bc"
+    std::string getPath(const std::string& key, const std::string& extension) const;
+
+    // True if the entry exists; marks it as recently used
+    bool lookup(const std::string& path);
+
+    // Copy a finished file into the cache as the entry at path
+    void insert(const std::string& file, const std::string& path);
+
+    // Write data into the cache as the entry at path
+    void store(llvm::StringRef data, const std::string& path);
+
+    const std::string& getDirectory() const { return directory_; }
+
+private:
+    std::string directory_;
+    uint64_t maxBytes_;
+    bool verbose_;
+};
+
+} // namespace jam
+
+#endif // BUILDCACHE_H
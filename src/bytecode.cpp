@@ -0,0 +1,669 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "bytecode.h"
+#include "codegen.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace jam {
+
+static uint64_t maskTo(uint64_t value, unsigned bits) {
+    return bits >= 64 ? value : value & ((uint64_t(1) << bits) - 1);
+}
+
+static uint64_t signExtend(uint64_t value, unsigned bits) {
+    return bits >= 64 ? value : static_cast<uint64_t>(static_cast<int64_t>(value << (64 - bits)) >> (64 - bits));
+}
+
+int BytecodeProgram::findFunction(const std::string& name) const {
+    for (size_t i = 0; i < functions.size(); i++) {
+        if (functions[i].name == name) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+BytecodeCompiler::BytecodeCompiler(const LayoutEngine& layouts) : layouts_(layouts) {}
+
+BCValue BytecodeCompiler::valueOfType(const std::string& type) const {
+    BCValue value;
+    if (type.empty()) {
+        return value;
+    }
+
+    value.kind = BCValue::Int;
+    if (type == "u8" || type == "i8") {
+        value.bits = 8;
+    } else if (type == "u16" || type == "i16") {
+        value.bits = 16;
+    } else if (type == "u32" || type == "i32") {
+        value.bits = 32;
+    } else if (type == "usize" || type == "isize") {
+        value.bits = (CodegenTarget ? CodegenTarget->getPointerSize() : 8) * 8;
+    } else if (type == "bool") {
+        value.bits = 1;
+    } else if (type == "str" || type.substr(0, 2) == "[]") {
+        value.kind = BCValue::Slice;
+    } else if (type[0] == '!') {
+        value.kind = BCValue::ErrorUnion;
+        BCValue payload = valueOfType(type.substr(1));
+        value.bits = payload.kind == BCValue::Int ? payload.bits : 0;
+    } else if (layouts_.lookup(type)) {
+        value.kind = BCValue::Struct;
+    } else {
+        throw std::runtime_error("Unknown type: " + type);
+    }
+    if (value.kind != BCValue::Int) {
+        value.type = type;
+    }
+    return value;
+}
+
+BCValue BytecodeCompiler::constant(uint64_t value, unsigned bits) const {
+    BCValue result;
+    result.kind = BCValue::Int;
+    result.bits = bits;
+    result.isConstant = true;
+    result.constant = maskTo(value, bits);
+    return result;
+}
+
+BCValue BytecodeCompiler::materialize(const BCValue& value) {
+    if (!value.isConstant) {
+        return value;
+    }
+    BCValue result = value;
+    result.isConstant = false;
+    result.reg = allocate(1);
+    function_->constants.push_back(value.constant);
+    emitWide(Op::LoadK, result.reg, static_cast<uint32_t>(function_->constants.size() - 1));
+    return result;
+}
+
+BCValue BytecodeCompiler::coerceLiteral(const BCValue& value, const BCValue& to) const {
+    // A literal's sign bit is its sign, as in codegen's coerceLiteral
+    if (value.isConstant && to.kind == BCValue::Int && value.bits != to.bits) {
+        return constant(signExtend(value.constant, value.bits), to.bits);
+    }
+    return value;
+}
+
+// Unsigned integer cast, as codegen's CreateIntCast(..., false). Callers
+// coerce literals first; those keep their sign.
+BCValue BytecodeCompiler::intCast(const BCValue& value, unsigned bits) {
+    if (value.bits == bits) {
+        return value;
+    }
+    if (value.isConstant) {
+        return constant(value.constant, bits);
+    }
+    BCValue result = constant(0, bits);
+    result.isConstant = false;
+    result.reg = allocate(1);
+    emit(Op::IntCast, bits, result.reg, value.reg);
+    return result;
+}
+
+BCValue BytecodeCompiler::zeroValue(const std::string& type) {
+    BCValue value = valueOfType(type);
+    value.reg = allocate(value.numRegisters());
+    BCValue zero = materialize(constant(0, 64));
+    for (unsigned i = 0; i < value.numRegisters(); i++) {
+        emit(Op::Move, 0, value.reg + i, zero.reg);
+    }
+    return value;
+}
+
+BCValue BytecodeCompiler::makeErrorUnion(const std::string& type, const BCValue& payload, const BCValue& code) {
+    BCValue value = valueOfType(type);
+    value.reg = allocate(2);
+    emit(Op::Move, 0, value.reg, materialize(payload).reg);
+    emit(Op::Move, 0, value.reg + 1, materialize(code).reg);
+    return value;
+}
+
+// Values of the same LLVM type are interchangeable, as in codegen: u8 and i8
+// are both i8, and all slices are { ptr, usize }
+void BytecodeCompiler::requireSameType(const BCValue& a, const BCValue& b, const std::string& what) const {
+    bool same = a.kind == b.kind;
+    if (same && a.kind == BCValue::Int) {
+        same = a.bits == b.bits;
+    } else if (same && a.kind != BCValue::Slice) {
+        same = a.type == b.type;
+    }
+    if (!same) {
+        throw std::runtime_error("Type mismatch in " + what);
+    }
+}
+
+uint16_t BytecodeCompiler::allocate(unsigned count) {
+    unsigned reg = function_->numRegisters;
+    function_->numRegisters += count;
+    if (function_->numRegisters > UINT16_MAX) {
+        throw std::runtime_error("Function " + function_->name + " needs too many registers for --interp");
+    }
+    return static_cast<uint16_t>(reg);
+}
+
+size_t BytecodeCompiler::emit(Op op, unsigned bits, unsigned a, unsigned b, unsigned c) {
+    function_->code.push_back({op, static_cast<uint8_t>(bits), static_cast<uint16_t>(a),
+                               static_cast<uint16_t>(b), static_cast<uint16_t>(c)});
+    return function_->code.size() - 1;
+}
+
+size_t BytecodeCompiler::emitWide(Op op, unsigned a, uint32_t wide) {
+    return emit(op, 0, a, wide >> 16, wide & 0xffff);
+}
+
+size_t BytecodeCompiler::here() const {
+    return function_->code.size();
+}
+
+void BytecodeCompiler::patch(size_t instruction, size_t target) {
+    function_->code[instruction].b = static_cast<uint16_t>(target >> 16);
+    function_->code[instruction].c = static_cast<uint16_t>(target & 0xffff);
+}
+
+void BytecodeCompiler::move(const BCValue& to, const BCValue& from) {
+    BCValue source = materialize(from);
+    for (unsigned i = 0; i < to.numRegisters(); i++) {
+        emit(Op::Move, 0, to.reg + i, source.reg + i);
+    }
+}
+
+void BytecodeCompiler::emitReturn(const BCValue& value) {
+    if (returnValue_.kind == BCValue::None) {
+        emit(Op::Ret, 0, 0, 0);
+        return;
+    }
+    emit(Op::Ret, 0, materialize(value).reg, returnValue_.numRegisters());
+}
+
+uint64_t BytecodeCompiler::internString(const std::string& value) {
+    program_.strings.push_back(value);
+    return reinterpret_cast<uintptr_t>(program_.strings.back().c_str());
+}
+
+const BytecodeCompiler::Callee& BytecodeCompiler::lookupFunction(const std::string& name) const {
+    auto it = callees_.find(name);
+    if (it != callees_.end()) {
+        return it->second;
+    }
+    if (externs_.count(name)) {
+        throw std::runtime_error("--interp cannot call extern function " + name);
+    }
+    throw std::runtime_error("Unknown function referenced: " + name);
+}
+
+BytecodeProgram BytecodeCompiler::compile(const std::vector<std::unique_ptr<FunctionAST>>& functions) {
+    // Register every prototype first so calls can refer to later functions
+    for (const auto& function : functions) {
+        if (function->isExtern) {
+            externs_.insert(function->Name);
+            continue;
+        }
+        if (callees_.count(function->Name)) {
+            throw std::runtime_error("Redefinition of function: " + function->Name);
+        }
+        Callee callee;
+        callee.index = static_cast<unsigned>(program_.functions.size());
+        for (const auto& arg : function->Args) {
+            callee.params.push_back(valueOfType(arg.second));
+        }
+        callee.result = valueOfType(function->ReturnType);
+        callees_[function->Name] = callee;
+        program_.functions.emplace_back();
+    }
+
+    for (const auto& function : functions) {
+        if (!function->isExtern) {
+            compileFunction(*function, program_.functions[callees_[function->Name].index]);
+        }
+    }
+    return std::move(program_);
+}
+
+void BytecodeCompiler::compileFunction(const FunctionAST& function, BytecodeFunction& out) {
+    const Callee& callee = callees_.at(function.Name);
+    function_ = &out;
+    out.name = function.Name;
+    variables_.clear();
+    loops_.clear();
+    returnValue_ = callee.result;
+    // main's result is the exit code, as with --run
+    if (function.Name == "main" && returnValue_.kind != BCValue::Int && returnValue_.kind != BCValue::None) {
+        throw std::runtime_error("main must return an integer or nothing");
+    }
+
+    for (size_t i = 0; i < function.Args.size(); i++) {
+        BCValue param = callee.params[i];
+        param.reg = allocate(param.numRegisters());
+        variables_[function.Args[i].first] = param;
+    }
+    out.numParams = out.numRegisters;
+    out.numResults = returnValue_.numRegisters();
+    out.resultBits = returnValue_.bits;
+
+    for (const auto& expr : function.Body) {
+        expr->emitBytecode(*this);
+    }
+
+    // Void functions return implicitly; codegen rejects other functions that
+    // can get here, so this only traps on paths it can't see are dead
+    if (returnValue_.kind == BCValue::None) {
+        emitReturn(returnValue_);
+    } else {
+        emit(Op::Unreachable, 0, 0);
+    }
+    function_ = nullptr;
+}
+
+} // namespace jam
+
+using jam::BCValue;
+using jam::Op;
+
+// Error union payloads zero-extend (literals keep their sign), as codegen's castToType
+static BCValue castToType(jam::BytecodeCompiler& C, const BCValue& value, const BCValue& to) {
+    if (value.kind == BCValue::Int && to.kind == BCValue::Int) {
+        return C.intCast(C.coerceLiteral(value, to), to.bits);
+    }
+    C.requireSameType(value, to, "error union value");
+    return value;
+}
+
+static BCValue noValue(jam::BytecodeCompiler& C) {
+    return C.constant(0, 8);
+}
+
+BCValue NumberExprAST::emitBytecode(jam::BytecodeCompiler& C) {
+    // Same widths as codegen picks for the literal
+    unsigned bits;
+    if (Val >= -128 && Val <= 127) {
+        bits = 8;
+    } else if (Val >= -32768 && Val <= 32767) {
+        bits = 16;
+    } else if (Val >= -2147483648LL && Val <= 2147483647LL) {
+        bits = 32;
+    } else {
+        bits = 64;
+    }
+    return C.constant(static_cast<uint64_t>(Val), bits);
+}
+
+BCValue BooleanExprAST::emitBytecode(jam::BytecodeCompiler& C) {
+    return C.constant(Val ? 1 : 0, 1);
+}
+
+BCValue StringLiteralExprAST::emitBytecode(jam::BytecodeCompiler& C) {
+    BCValue value = C.materialize(C.constant(C.internString(Val), 64));
+    value.kind = BCValue::Slice;
+    value.bits = 0;
+    value.type = "str";
+    return value;
+}
+
+BCValue TargetConstantExprAST::emitBytecode(jam::BytecodeCompiler& C) {
+    if (!CodegenTarget || !CodegenCPU)
+        throw std::runtime_error("@target." + Name + " used without a codegen target");
+
+    if (Name == "cache_line") {
+        return NumberExprAST(CodegenTarget->getCacheLineSize()).emitBytecode(C);
+    } else if (Name == "vector_bits") {
+        return NumberExprAST(CodegenCPU->getVectorBits(*CodegenTarget)).emitBytecode(C);
+    } else if (Name == "pointer_size") {
+        return NumberExprAST(CodegenTarget->getPointerSize()).emitBytecode(C);
+    } else if (Name == "arch") {
+        return StringLiteralExprAST(CodegenTarget->getArchName()).emitBytecode(C);
+    } else if (Name == "os") {
+        return StringLiteralExprAST(CodegenTarget->getOSName()).emitBytecode(C);
+    }
+
+    throw std::runtime_error("Unknown target constant: @target." + Name);
+}
+
+BCValue VariableExprAST::emitBytecode(jam::BytecodeCompiler& C) {
+    auto it = C.variables().find(Name);
+    if (it == C.variables().end())
+        throw std::runtime_error("Unknown variable name: " + Name);
+    return it->second;
+}
+
+BCValue FieldAccessExprAST::emitBytecode(jam::BytecodeCompiler& C) {
+    auto it = C.variables().find(VarName);
+    if (it == C.variables().end())
+        throw std::runtime_error("Unknown variable name: " + VarName);
+
+    // Struct values are always zero-initialized (there is no field
+    // assignment), so only the field's type needs resolving
+    std::string type = it->second.type;
+    for (const auto& Field : Fields) {
+        const jam::StructLayout* Layout = C.lookupStruct(type);
+        if (!Layout)
+            throw std::runtime_error("Field access on non-struct value: " + VarName + "." + Field);
+
+        int Idx = Layout->getFieldIndex(Field);
+        if (Idx < 0)
+            throw std::runtime_error("Struct " + Layout->name + " has no field named " + Field);
+        type = Layout->fields[Idx].type;
+    }
+    return C.zeroValue(type);
+}
+
+BCValue BinaryExprAST::emitBytecode(jam::BytecodeCompiler& C) {
+    BCValue L = LHS->emitBytecode(C);
+    BCValue R = RHS->emitBytecode(C);
+    L = C.coerceLiteral(L, R);
+    R = C.coerceLiteral(R, L);
+    if (L.kind != BCValue::Int || R.kind != BCValue::Int)
+        throw std::runtime_error("Binary operator " + Op + " needs integer operands");
+    C.requireSameType(L, R, "binary expression " + Op);
+
+    jam::Op Opcode;
+    if (Op == "+")
+        Opcode = jam::Op::Add;
+    else if (Op == "==")
+        Opcode = jam::Op::Eq;
+    else if (Op == "!=")
+        Opcode = jam::Op::Ne;
+    else if (Op == "<")
+        Opcode = jam::Op::Ult;
+    else if (Op == "<=")
+        Opcode = jam::Op::Ule;
+    else if (Op == ">")
+        Opcode = jam::Op::Ugt;
+    else if (Op == ">=")
+        Opcode = jam::Op::Uge;
+    else
+        throw std::runtime_error("Invalid binary operator: " + Op);
+
+    unsigned ResultBits = Opcode == jam::Op::Add ? L.bits : 1;
+
+    // Literal operands fold, as IRBuilder folds constants
+    if (L.isConstant && R.isConstant) {
+        uint64_t Result;
+        switch (Opcode) {
+            case jam::Op::Add: Result = L.constant + R.constant; break;
+            case jam::Op::Eq: Result = L.constant == R.constant; break;
+            case jam::Op::Ne: Result = L.constant != R.constant; break;
+            case jam::Op::Ult: Result = L.constant < R.constant; break;
+            case jam::Op::Ule: Result = L.constant <= R.constant; break;
+            case jam::Op::Ugt: Result = L.constant > R.constant; break;
+            default: Result = L.constant >= R.constant; break;
+        }
+        return C.constant(Result, ResultBits);
+    }
+
+    L = C.materialize(L);
+    R = C.materialize(R);
+    BCValue Result = C.constant(0, ResultBits);
+    Result.isConstant = false;
+    Result.reg = C.allocate(1);
+    C.emit(Opcode, L.bits, Result.reg, L.reg, R.reg);
+    return Result;
+}
+
+BCValue CallExprAST::emitBytecode(jam::BytecodeCompiler& C) {
+    if (isPrintCall()) {
+        if ((Callee != "println" && Callee != "print") || Args.size() != 1)
+            throw std::runtime_error("Complex print formatting not yet implemented");
+        BCValue Arg = Args[0]->emitBytecode(C);
+        if (Arg.kind != BCValue::Slice)
+            throw std::runtime_error(Callee + " expects a string");
+
+        // printf and puts return an int
+        BCValue Result = C.constant(0, 32);
+        Result.isConstant = false;
+        Result.reg = C.allocate(1);
+        C.emit(Callee == "println" ? Op::Println : Op::Print, 0, Result.reg, Arg.reg);
+        return Result;
+    }
+
+    const jam::BytecodeCompiler::Callee& Target = C.lookupFunction(Callee);
+    if (Target.params.size() != Args.size())
+        throw std::runtime_error("Incorrect number of arguments passed");
+
+    std::vector<BCValue> ArgsV;
+    unsigned NumArgRegs = 0;
+    for (size_t i = 0; i < Args.size(); i++) {
+        BCValue Arg = C.coerceLiteral(Args[i]->emitBytecode(C), Target.params[i]);
+        C.requireSameType(Arg, Target.params[i], "argument " + std::to_string(i + 1) + " of " + Callee);
+        ArgsV.push_back(C.materialize(Arg));
+        NumArgRegs += Arg.numRegisters();
+    }
+
+    // Arguments are copied into a contiguous window that also receives the results
+    unsigned Base = C.allocate(std::max(NumArgRegs, Target.result.numRegisters()));
+    unsigned Next = Base;
+    for (const auto& Arg : ArgsV) {
+        for (unsigned i = 0; i < Arg.numRegisters(); i++) {
+            C.emit(Op::Move, 0, Next++, Arg.reg + i);
+        }
+    }
+    C.emit(Op::Call, 0, Base, Target.index, NumArgRegs);
+
+    BCValue Result = Target.result;
+    Result.reg = static_cast<uint16_t>(Base);
+    return Result;
+}
+
+BCValue ReturnExprAST::emitBytecode(jam::BytecodeCompiler& C) {
+    BCValue Value = RetVal->emitBytecode(C);
+    const BCValue& FnRet = C.returnValue();
+    if (FnRet.kind == BCValue::None)
+        throw std::runtime_error("return with a value in a void function");
+
+    // Returning a plain value from an error union function: { value, 0 }
+    if (FnRet.kind == BCValue::ErrorUnion && !(Value.kind == BCValue::ErrorUnion && Value.type == FnRet.type)) {
+        BCValue Payload = castToType(C, Value, C.valueOfType(FnRet.type.substr(1)));
+        Value = C.makeErrorUnion(FnRet.type, Payload, C.constant(0, 16));
+    }
+    Value = C.coerceLiteral(Value, FnRet);
+    C.requireSameType(Value, FnRet, "return value");
+
+    C.emitReturn(Value);
+    return Value;
+}
+
+BCValue ErrorExprAST::emitBytecode(jam::BytecodeCompiler& C) {
+    const BCValue& FnRet = C.returnValue();
+    if (FnRet.kind != BCValue::ErrorUnion)
+        throw std::runtime_error("error() used in a function that does not return an error union");
+
+    BCValue CodeV = Code->emitBytecode(C);
+    if (CodeV.kind != BCValue::Int)
+        throw std::runtime_error("error code must be an integer");
+    if (CodeV.isConstant && CodeV.constant == 0)
+        throw std::runtime_error("error code 0 is reserved for success");
+
+    // Unsigned cast to u16: registers are already zero-extended, so only
+    // wider codes need truncating
+    if (CodeV.isConstant) {
+        CodeV = C.constant(CodeV.constant, 16);
+    } else if (CodeV.bits > 16) {
+        BCValue Narrow = C.constant(0, 16);
+        Narrow.isConstant = false;
+        Narrow.reg = C.allocate(1);
+        C.emit(Op::IntCast, 16, Narrow.reg, CodeV.reg);
+        CodeV = Narrow;
+    }
+
+    return C.makeErrorUnion(FnRet.type, C.zeroValue(FnRet.type.substr(1)), CodeV);
+}
+
+BCValue TryExprAST::emitBytecode(jam::BytecodeCompiler& C) {
+    BCValue Union = Operand->emitBytecode(C);
+    if (Union.kind != BCValue::ErrorUnion)
+        throw std::runtime_error("try requires an error union operand");
+    const BCValue& FnRet = C.returnValue();
+    if (FnRet.kind != BCValue::ErrorUnion)
+        throw std::runtime_error("try used in a function that does not return an error union");
+
+    // Propagate the error code to our caller
+    size_t OkJump = C.emitWide(Op::JumpIfZero, Union.reg + 1, 0);
+    BCValue Code = C.constant(0, 16);
+    Code.isConstant = false;
+    Code.reg = Union.reg + 1;
+    C.emitReturn(C.makeErrorUnion(FnRet.type, C.zeroValue(FnRet.type.substr(1)), Code));
+    C.patch(OkJump, C.here());
+
+    BCValue Payload = C.valueOfType(Union.type.substr(1));
+    Payload.reg = Union.reg;
+    return Payload;
+}
+
+BCValue CatchExprAST::emitBytecode(jam::BytecodeCompiler& C) {
+    BCValue Union = Operand->emitBytecode(C);
+    if (Union.kind != BCValue::ErrorUnion)
+        throw std::runtime_error("catch requires an error union operand");
+
+    BCValue OkV = C.valueOfType(Union.type.substr(1));
+    OkV.reg = Union.reg;
+    BCValue Result = C.valueOfType(Union.type.substr(1));
+    Result.reg = C.allocate(Result.numRegisters());
+    C.move(Result, OkV);
+
+    size_t OkJump = C.emitWide(Op::JumpIfZero, Union.reg + 1, 0);
+    BCValue FallbackV = castToType(C, Fallback->emitBytecode(C), OkV);
+    C.move(Result, FallbackV);
+    C.patch(OkJump, C.here());
+    return Result;
+}
+
+BCValue VarDeclAST::emitBytecode(jam::BytecodeCompiler& C) {
+    BCValue Var = C.valueOfType(Type);
+    if (Init) {
+        BCValue InitVal = C.coerceLiteral(Init->emitBytecode(C), Var);
+        C.requireSameType(InitVal, Var, "initializer of " + Name);
+        Var.reg = C.allocate(Var.numRegisters());
+        C.move(Var, InitVal);
+    } else {
+        Var = C.zeroValue(Type);
+    }
+
+    C.variables()[Name] = Var;
+    return Var;
+}
+
+BCValue IfExprAST::emitBytecode(jam::BytecodeCompiler& C) {
+    BCValue CondV = Condition->emitBytecode(C);
+    if (CondV.kind != BCValue::Int)
+        throw std::runtime_error("if condition must be an integer or bool");
+
+    size_t ElseJump = C.emitWide(Op::JumpIfZero, C.materialize(CondV).reg, 0);
+    for (auto& Expr : ThenBody) {
+        Expr->emitBytecode(C);
+    }
+    size_t EndJump = C.emitWide(Op::Jump, 0, 0);
+
+    C.patch(ElseJump, C.here());
+    for (auto& Expr : ElseBody) {
+        Expr->emitBytecode(C);
+    }
+    C.patch(EndJump, C.here());
+
+    return noValue(C);
+}
+
+BCValue WhileExprAST::emitBytecode(jam::BytecodeCompiler& C) {
+    size_t CondStart = C.here();
+    BCValue CondV = Condition->emitBytecode(C);
+    if (CondV.kind != BCValue::Int)
+        throw std::runtime_error("while condition must be an integer or bool");
+    size_t ExitJump = C.emitWide(Op::JumpIfZero, C.materialize(CondV).reg, 0);
+
+    C.loops().emplace_back();
+    for (auto& Expr : Body) {
+        Expr->emitBytecode(C);
+    }
+    C.emitWide(Op::Jump, 0, static_cast<uint32_t>(CondStart));
+
+    jam::BytecodeCompiler::Loop Loop = std::move(C.loops().back());
+    C.loops().pop_back();
+    C.patch(ExitJump, C.here());
+    for (size_t Break : Loop.breaks) {
+        C.patch(Break, C.here());
+    }
+    for (size_t Continue : Loop.continues) {
+        C.patch(Continue, CondStart);
+    }
+
+    return noValue(C);
+}
+
+BCValue ForExprAST::emitBytecode(jam::BytecodeCompiler& C) {
+    // The loop variable takes the start value's type, as in codegen
+    BCValue StartVal = Start->emitBytecode(C);
+    BCValue EndVal = End->emitBytecode(C);
+    if (StartVal.kind != BCValue::Int || EndVal.kind != BCValue::Int)
+        throw std::runtime_error("Type mismatch in for loop range");
+    EndVal = C.materialize(C.intCast(C.coerceLiteral(EndVal, StartVal), StartVal.bits));
+
+    BCValue Var = C.constant(0, StartVal.bits);
+    Var.isConstant = false;
+    Var.reg = C.allocate(1);
+    C.move(Var, StartVal);
+
+    auto& Variables = C.variables();
+    auto Old = Variables.find(VarName);
+    bool HadOld = Old != Variables.end();
+    BCValue OldVal = HadOld ? Old->second : BCValue();
+    Variables[VarName] = Var;
+
+    size_t CondStart = C.here();
+    BCValue CondV = C.constant(0, 1);
+    CondV.isConstant = false;
+    CondV.reg = C.allocate(1);
+    C.emit(Op::Slt, Var.bits, CondV.reg, Var.reg, EndVal.reg);
+    size_t ExitJump = C.emitWide(Op::JumpIfZero, CondV.reg, 0);
+
+    C.loops().emplace_back();
+    for (auto& Expr : Body) {
+        Expr->emitBytecode(C);
+    }
+
+    // continue goes to the increment
+    size_t Increment = C.here();
+    BCValue One = C.materialize(C.constant(1, Var.bits));
+    C.emit(Op::Add, Var.bits, Var.reg, Var.reg, One.reg);
+    C.emitWide(Op::Jump, 0, static_cast<uint32_t>(CondStart));
+
+    jam::BytecodeCompiler::Loop Loop = std::move(C.loops().back());
+    C.loops().pop_back();
+    C.patch(ExitJump, C.here());
+    for (size_t Break : Loop.breaks) {
+        C.patch(Break, C.here());
+    }
+    for (size_t Continue : Loop.continues) {
+        C.patch(Continue, Increment);
+    }
+
+    if (HadOld)
+        Variables[VarName] = OldVal;
+    else
+        Variables.erase(VarName);
+
+    return noValue(C);
+}
+
+BCValue BreakExprAST::emitBytecode(jam::BytecodeCompiler& C) {
+    if (C.loops().empty()) {
+        throw std::runtime_error("break statement not inside a loop");
+    }
+    C.loops().back().breaks.push_back(C.emitWide(Op::Jump, 0, 0));
+    return noValue(C);
+}
+
+BCValue ContinueExprAST::emitBytecode(jam::BytecodeCompiler& C) {
+    if (C.loops().empty()) {
+        throw std::runtime_error("continue statement not inside a loop");
+    }
+    C.loops().back().continues.push_back(C.emitWide(Op::Jump, 0, 0));
+    return noValue(C);
+}
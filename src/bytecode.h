@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include "ast.h"
+#include "layout.h"
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace jam {
+
+// Register-based bytecode for --interp.
+//
+// Every function has a fixed set of 64-bit registers: parameters first, then
+// locals and temporaries. Integers are kept zero-extended to their width, so
+// arithmetic masks its result and signed compares sign-extend on the fly.
+// Slices hold a pointer to their (NUL-terminated) data, structs hold nothing
+// (Jam structs are always zero-initialized), and error unions take two
+// consecutive registers: the payload and the u16 error code.
+enum class Op : uint8_t {
+    LoadK,        // a = constants[wide]
+    Move,         // a = b
+    Add,          // a = (b + c) & mask(bits)
+    Eq,           // a = b == c
+    Ne,           // a = b != c
+    Ult,          // a = b < c, unsigned
+    Ule,          // a = b <= c, unsigned
+    Ugt,          // a = b > c, unsigned
+    Uge,          // a = b >= c, unsigned
+    Slt,          // a = b < c, signed at width bits
+    IntCast,      // a = b & mask(bits)
+    Jump,         // pc = wide
+    JumpIfZero,   // if a == 0: pc = wide
+    Call,         // call functions[b] with c argument registers from a; results to a, a + 1
+    Ret,          // return b registers starting at a
+    Print,        // a = printf("%s", b)
+    Println,      // a = puts(b)
+    Unreachable,  // fell off the end of a non-void function
+    Count
+};
+
+struct Instruction {
+    Op op;
+    uint8_t bits;  // operand width for Add, compares and IntCast
+    uint16_t a;
+    uint16_t b;
+    uint16_t c;
+
+    // Jump targets and constant indices use b and c as one 32-bit operand
+    uint32_t wide() const { return (static_cast<uint32_t>(b) << 16) | c; }
+};
+
+struct BytecodeFunction {
+    std::string name;
+    unsigned numParams = 0;     // parameter registers
+    unsigned numRegisters = 0;  // parameters, locals and temporaries
+    unsigned numResults = 0;    // 0 (void), 1, or 2 (error union)
+    unsigned resultBits = 0;    // width of an integer result
+    std::vector<Instruction> code;
+    std::vector<uint64_t> constants;
+};
+
+struct BytecodeProgram {
+    std::vector<BytecodeFunction> functions;
+    std::deque<std::string> strings;  // string literal storage; slices point into it
+
+    // Index of a function, or -1
+    int findFunction(const std::string& name) const;
+};
+
+// A value during bytecode compilation: its type and where it lives.
+// Integer literals stay constants until they are used, so they can take the
+// type their context expects, the way codegen's coerceLiteral does.
+struct BCValue {
+    enum Kind : uint8_t { None, Int, Slice, Struct, ErrorUnion };
+
+    Kind kind = None;
+    unsigned bits = 0;       // Int (1 for bool), or an ErrorUnion's integer payload
+    std::string type;        // Jam spelling for Slice, Struct and ErrorUnion
+    uint16_t reg = 0;        // first register
+    bool isConstant = false; // integer literal, not in a register yet
+    uint64_t constant = 0;   // masked to bits
+
+    unsigned numRegisters() const { return kind == ErrorUnion ? 2 : kind == None ? 0 : 1; }
+};
+
+// Compiles Jam functions straight from the AST to bytecode, with no LLVM
+// involved. Each ExprAST node emits its own code through emitBytecode; this
+// class holds the per-function state those methods share. Errors are thrown
+// as std::runtime_error, including for constructs --interp cannot run
+// (extern C functions).
+class BytecodeCompiler {
+public:
+    explicit BytecodeCompiler(const LayoutEngine& layouts);
+
+    BytecodeProgram compile(const std::vector<std::unique_ptr<FunctionAST>>& functions);
+
+    // Used by ExprAST::emitBytecode
+    BCValue valueOfType(const std::string& type) const;
+    BCValue constant(uint64_t value, unsigned bits) const;
+    BCValue materialize(const BCValue& value);
+    BCValue coerceLiteral(const BCValue& value, const BCValue& to) const;
+    BCValue intCast(const BCValue& value, unsigned bits);
+    BCValue zeroValue(const std::string& type);
+    BCValue makeErrorUnion(const std::string& type, const BCValue& payload, const BCValue& code);
+    void requireSameType(const BCValue& a, const BCValue& b, const std::string& what) const;
+
+    uint16_t allocate(unsigned count);
+    size_t emit(Op op, unsigned bits, unsigned a, unsigned b = 0, unsigned c = 0);
+    size_t emitWide(Op op, unsigned a, uint32_t wide);
+    size_t here() const;
+    void patch(size_t instruction, size_t target);
+    void move(const BCValue& to, const BCValue& from);
+    void emitReturn(const BCValue& value);
+
+    uint64_t internString(const std::string& value);
+    const StructLayout* lookupStruct(const std::string& name) const { return layouts_.lookup(name); }
+
+    std::map<std::string, BCValue>& variables() { return variables_; }
+    const BCValue& returnValue() const { return returnValue_; }
+
+    struct Callee {
+        unsigned index;
+        std::vector<BCValue> params;
+        BCValue result;
+    };
+    const Callee& lookupFunction(const std::string& name) const;
+
+    struct Loop {
+        std::vector<size_t> breaks;
+        std::vector<size_t> continues;
+    };
+    std::vector<Loop>& loops() { return loops_; }
+
+private:
+    const LayoutEngine& layouts_;
+    BytecodeProgram program_;
+    std::map<std::string, Callee> callees_;
+    std::set<std::string> externs_;
+
+    // Current function
+    BytecodeFunction* function_ = nullptr;
+    std::map<std::string, BCValue> variables_;
+    BCValue returnValue_;
+    std::vector<Loop> loops_;
+
+    void compileFunction(const FunctionAST& function, BytecodeFunction& out);
+};
+
+} // namespace jam
+
+#endif // BYTECODE_H
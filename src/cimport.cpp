@@ -0,0 +1,328 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "cimport.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Program.h"
+#include <stdexcept>
+
+#ifdef JAM_HAVE_LIBCLANG
+#include <clang-c/Index.h>
+#endif
+
+namespace jam {
+
+CImporter::CImporter(const Target& target, std::vector<std::string> includeDirs)
+    : target_(target), includeDirs_(std::move(includeDirs)) {}
+
+std::string CImporter::resolveHeader(const std::string& header, const std::string& sourceDir) const {
+    if (llvm::sys::path::is_absolute(header)) {
+        return header;
+    }
+
+    std::vector<std::string> searchDirs = {sourceDir.empty() ? "." : sourceDir};
+    searchDirs.insert(searchDirs.end(), includeDirs_.begin(), includeDirs_.end());
+    for (const auto& dir : searchDirs) {
+        llvm::SmallString<256> candidate(dir);
+        llvm::sys::path::append(candidate, header);
+        if (llvm::sys::fs::exists(candidate)) {
+            return std::string(candidate);
+        }
+    }
+    throw std::runtime_error("@cImport: cannot find header \"" + header + "\"");
+}
+
+std::vector<std::string> CImporter::getClangArgs() const {
+    std::vector<std::string> args = {"-x", "c", "-target", target_.toLLVMTriple()};
+    for (const auto& dir : includeDirs_) {
+        args.push_back("-I" + dir);
+    }
+    return args;
+}
+
+#ifdef JAM_HAVE_LIBCLANG
+
+static std::string toString(CXString str) {
+    std::string result = clang_getCString(str);
+    clang_disposeString(str);
+    return result;
+}
+
+// Jam spelling of a C type, or "" if Jam has no exact equivalent
+static std::string toJamType(CXType type, const Target& target, const std::set<std::string>& structs) {
+    type = clang_getCanonicalType(type);
+
+    bool isSigned = false;
+    switch (type.kind) {
+        case CXType_Bool:
+            return "bool";
+        case CXType_Char_S:
+        case CXType_SChar:
+        case CXType_Short:
+        case CXType_Int:
+        case CXType_Long:
+        case CXType_LongLong:
+            isSigned = true;
+            break;
+        case CXType_Char_U:
+        case CXType_UChar:
+        case CXType_UShort:
+        case CXType_UInt:
+        case CXType_ULong:
+        case CXType_ULongLong:
+            break;
+        case CXType_Enum:
+            return toJamType(clang_getEnumDeclIntegerType(clang_getTypeDeclaration(type)), target, structs);
+        case CXType_Record: {
+            std::string name = toString(clang_getCursorSpelling(clang_getTypeDeclaration(type)));
+            return structs.count(name) ? name : "";
+        }
+        default:
+            return "";
+    }
+
+    long long bits = clang_Type_getSizeOf(type) * 8;
+    if (bits == 8 || bits == 16 || bits == 32) {
+        return (isSigned ? "i" : "u") + std::to_string(bits);
+    } else if (bits == target.getPointerSize() * 8) {
+        return isSigned ? "isize" : "usize";
+    }
+    return "";
+}
+
+struct VisitState {
+    const Target& target;
+    std::set<std::string>& importedNames;
+    std::set<std::string>& structNames;
+    std::set<std::string> inlineFunctions;
+    CImportResult result;
+};
+
+static bool translateStruct(CXCursor cursor, VisitState& state) {
+    std::string name = toString(clang_getCursorSpelling(cursor));
+    if (name.empty() || clang_Cursor_isAnonymous(cursor)) {
+        return false;
+    }
+
+    struct FieldState {
+        VisitState& state;
+        std::vector<FieldDecl> fields;
+        bool ok = true;
+    } fieldState{state};
+
+    clang_visitChildren(cursor, [](CXCursor field, CXCursor, CXClientData data) {
+        auto& fs = *static_cast<FieldState*>(data);
+        if (clang_getCursorKind(field) != CXCursor_FieldDecl) {
+            return CXChildVisit_Continue;
+        }
+        FieldDecl decl;
+        decl.name = toString(clang_getCursorSpelling(field));
+        decl.type = toJamType(clang_getCursorType(field), fs.state.target, fs.state.structNames);
+        if (decl.type.empty() || clang_Cursor_isBitField(field)) {
+            fs.ok = false;
+            return CXChildVisit_Break;
+        }
+        fs.fields.push_back(decl);
+        return CXChildVisit_Continue;
+    }, &fieldState);
+
+    if (!fieldState.ok || fieldState.fields.empty()) {
+        return false;
+    }
+    state.structNames.insert(name);
+    state.result.structs.push_back(std::make_unique<StructAST>(name, std::move(fieldState.fields), true));
+    return true;
+}
+
+static bool translateFunction(CXCursor cursor, VisitState& state) {
+    std::string name = toString(clang_getCursorSpelling(cursor));
+    CXType type = clang_getCursorType(cursor);
+    if (clang_isFunctionTypeVariadic(type)) {
+        return false;
+    }
+
+    // Aggregates by value need C ABI lowering that extern fn does not apply
+    std::string returnType;
+    CXType resultType = clang_getCanonicalType(clang_getResultType(type));
+    if (resultType.kind != CXType_Void) {
+        if (resultType.kind == CXType_Record) {
+            return false;
+        }
+        returnType = toJamType(resultType, state.target, state.structNames);
+        if (returnType.empty()) {
+            return false;
+        }
+    }
+
+    std::vector<std::pair<std::string, std::string>> args;
+    int numArgs = clang_Cursor_getNumArguments(cursor);
+    for (int i = 0; i < numArgs; i++) {
+        CXCursor arg = clang_Cursor_getArgument(cursor, i);
+        CXType argType = clang_getCanonicalType(clang_getCursorType(arg));
+        std::string jamType = argType.kind == CXType_Record ? "" : toJamType(argType, state.target, state.structNames);
+        if (jamType.empty()) {
+            return false;
+        }
+        std::string argName = toString(clang_getCursorSpelling(arg));
+        args.emplace_back(argName.empty() ? "arg" + std::to_string(i) : argName, jamType);
+    }
+
+    if (clang_Cursor_getStorageClass(cursor) == CX_SC_Static) {
+        // Only a definition can be linked in from bitcode
+        if (!clang_isCursorDefinition(cursor)) {
+            return false;
+        }
+        state.inlineFunctions.insert(name);
+    }
+
+    std::vector<std::unique_ptr<ExprAST>> emptyBody;
+    state.result.functions.push_back(std::make_unique<FunctionAST>(name, std::move(args), returnType, std::move(emptyBody), true, false));
+    return true;
+}
+
+CImportResult CImporter::importHeader(const std::string& path) {
+    std::vector<std::string> args = getClangArgs();
+    std::vector<const char*> argv;
+    for (const auto& arg : args) {
+        argv.push_back(arg.c_str());
+    }
+
+    CXIndex index = clang_createIndex(/*excludeDeclarationsFromPCH=*/0, /*displayDiagnostics=*/1);
+    CXTranslationUnit unit = nullptr;
+    CXErrorCode error = clang_parseTranslationUnit2(index, path.c_str(), argv.data(), static_cast<int>(argv.size()),
+                                                    nullptr, 0, CXTranslationUnit_None, &unit);
+    if (error != CXError_Success || !unit) {
+        clang_disposeIndex(index);
+        throw std::runtime_error("@cImport: failed to parse " + path);
+    }
+
+    unsigned numDiagnostics = clang_getNumDiagnostics(unit);
+    for (unsigned i = 0; i < numDiagnostics; i++) {
+        CXDiagnostic diagnostic = clang_getDiagnostic(unit, i);
+        bool fatal = clang_getDiagnosticSeverity(diagnostic) >= CXDiagnostic_Error;
+        clang_disposeDiagnostic(diagnostic);
+        if (fatal) {
+            clang_disposeTranslationUnit(unit);
+            clang_disposeIndex(index);
+            throw std::runtime_error("@cImport: errors in " + path);
+        }
+    }
+
+    VisitState state{target_, importedNames_, importedStructs_};
+    clang_visitChildren(clang_getTranslationUnitCursor(unit), [](CXCursor cursor, CXCursor, CXClientData data) {
+        auto& state = *static_cast<VisitState*>(data);
+        if (clang_Location_isInSystemHeader(clang_getCursorLocation(cursor))) {
+            return CXChildVisit_Continue;
+        }
+
+        CXCursorKind kind = clang_getCursorKind(cursor);
+        if (kind == CXCursor_StructDecl && clang_isCursorDefinition(cursor)) {
+            std::string name = toString(clang_getCursorSpelling(cursor));
+            if (!state.importedNames.count(name) && translateStruct(cursor, state)) {
+                state.importedNames.insert(name);
+            }
+        } else if (kind == CXCursor_FunctionDecl) {
+            std::string name = toString(clang_getCursorSpelling(cursor));
+            if (!state.importedNames.count(name) && translateFunction(cursor, state)) {
+                state.importedNames.insert(name);
+            }
+        }
+        return CXChildVisit_Continue;
+    }, &state);
+
+    clang_disposeTranslationUnit(unit);
+    clang_disposeIndex(index);
+
+    if (!state.inlineFunctions.empty()) {
+        inlineFunctions_.emplace_back(path, std::move(state.inlineFunctions));
+    }
+    return std::move(state.result);
+}
+
+#else
+
+CImportResult CImporter::importHeader(const std::string& path) {
+    throw std::runtime_error("@cImport(\"" + path + "\") requires jam to be built with libclang");
+}
+
+#endif // JAM_HAVE_LIBCLANG
+
+void CImporter::linkInlineFunctions(llvm::Module& module) const {
+    for (const auto& [header, names] : inlineFunctions_) {
+        // Skip the clang run when nothing from this header is called
+        bool used = false;
+        for (const auto& name : names) {
+            llvm::Function* decl = module.getFunction(name);
+            used |= decl && !decl->use_empty();
+        }
+        if (!used) {
+            continue;
+        }
+
+        llvm::SmallString<128> bitcodePath;
+        if (llvm::sys::fs::createTemporaryFile("jam-cimport", "bc", bitcodePath)) {
+            throw std::runtime_error("@cImport: cannot create a temporary file");
+        }
+        llvm::FileRemover remover(bitcodePath);
+
+        // -femit-all-decls keeps unused static functions; optnone is left off
+        // so the Jam pipeline can inline and optimize them
+        auto clang = llvm::sys::findProgramByName("clang");
+        if (!clang) {
+            throw std::runtime_error("@cImport: clang is needed to compile static functions from " + header);
+        }
+        std::vector<std::string> args = {*clang, "-c", "-emit-llvm", "-femit-all-decls",
+                                          "-O1", "-Xclang", "-disable-llvm-passes",
+                                          "-x", "c", "-target", target_.toLLVMTriple()};
+        for (const auto& dir : includeDirs_) {
+            args.push_back("-I" + dir);
+        }
+        args.insert(args.end(), {header, "-o", std::string(bitcodePath)});
+        std::vector<llvm::StringRef> argv(args.begin(), args.end());
+        if (llvm::sys::ExecuteAndWait(*clang, argv) != 0) {
+            throw std::runtime_error("@cImport: failed to compile static functions from " + header);
+        }
+
+        auto buffer = llvm::MemoryBuffer::getFile(bitcodePath);
+        if (!buffer) {
+            throw std::runtime_error("@cImport: cannot read " + std::string(bitcodePath));
+        }
+        auto parsed = llvm::parseBitcodeFile((*buffer)->getMemBufferRef(), module.getContext());
+        if (!parsed) {
+            throw std::runtime_error("@cImport: " + llvm::toString(parsed.takeError()));
+        }
+        std::unique_ptr<llvm::Module> cModule = std::move(*parsed);
+        cModule->setTargetTriple(module.getTargetTriple());
+        cModule->setDataLayout(module.getDataLayout());
+
+        // Internal definitions only resolve Jam's declarations once they are visible
+        for (const auto& name : names) {
+            if (llvm::Function* func = cModule->getFunction(name)) {
+                func->setLinkage(llvm::Function::ExternalLinkage);
+            }
+        }
+        if (llvm::Linker::linkModules(module, std::move(cModule), llvm::Linker::Flags::LinkOnlyNeeded)) {
+            throw std::runtime_error("@cImport: failed to link static functions from " + header);
+        }
+
+        // Back to internal: they are inlined or kept local, never exported
+        for (const auto& name : names) {
+            llvm::Function* func = module.getFunction(name);
+            if (func && !func->isDeclaration()) {
+                func->setLinkage(llvm::Function::InternalLinkage);
+            }
+        }
+    }
+}
+
+} // namespace jam
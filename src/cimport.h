@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef CIMPORT_H
+#define CIMPORT_H
+
+#include "ast.h"
+#include "target.h"
+#include "llvm/IR/Module.h"
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace jam {
+
+// Declarations translated from one C header
+struct CImportResult {
+    std::vector<std::unique_ptr<StructAST>> structs;     // extern structs (C layout)
+    std::vector<std::unique_ptr<FunctionAST>> functions; // extern fn prototypes
+};
+
+// @cImport("foo.h"): translate C declarations into Jam externs with libclang.
+//
+// Integer, bool and enum types map to the Jam type of the same width and
+// signedness; 64-bit integers map to usize/isize on 64-bit targets. Structs
+// whose fields all map become extern structs. Declarations from system
+// headers, variadic functions and anything with an unmappable type are
+// skipped.
+//
+// static / static inline functions have no symbol to link against, so the
+// header is also compiled to bitcode and the definitions the module calls are
+// linked in as internal functions, where the optimizer can inline them.
+class CImporter {
+public:
+    CImporter(const Target& target, std::vector<std::string> includeDirs);
+
+    // Find a header next to the Jam source first, then in the -I directories
+    std::string resolveHeader(const std::string& header, const std::string& sourceDir) const;
+
+    // Translate a header's declarations; names already imported are skipped
+    CImportResult importHeader(const std::string& path);
+
+    // Compile the imported headers' static functions and link the used ones
+    void linkInlineFunctions(llvm::Module& module) const;
+
+private:
+    const Target& target_;
+    std::vector<std::string> includeDirs_;
+    std::set<std::string> importedNames_;
+    std::set<std::string> importedStructs_;
+    std::vector<std::pair<std::string, std::set<std::string>>> inlineFunctions_;  // (header, names)
+
+    std::vector<std::string> getClangArgs() const;
+};
+
+} // namespace jam
+
+#endif // CIMPORT_H
@@ -9,6 +9,14 @@
 #include <stdexcept>
 #include "llvm/IR/DerivedTypes.h"
 
+thread_local const jam::Target* CodegenTarget = nullptr;
+thread_local const jam::CPUModel* CodegenCPU = nullptr;
+
+llvm::Type* getUsizeType(llvm::LLVMContext& context) {
+    int pointerSize = CodegenTarget ? CodegenTarget->getPointerSize() : 8;
+    return llvm::Type::getIntNTy(context, pointerSize * 8);
+}
+
 llvm::Type* getTypeFromString(const std::string& typeStr, llvm::LLVMContext& context) {
     if (typeStr == "u8" || typeStr == "i8") {
         return llvm::Type::getInt8Ty(context);
@@ -16,20 +24,38 @@ llvm::Type* getTypeFromString(const std::string& typeStr, llvm::LLVMContext& con
         return llvm::Type::getInt16Ty(context);
     } else if (typeStr == "u32" || typeStr == "i32") {
         return llvm::Type::getInt32Ty(context);
+    } else if (typeStr == "usize" || typeStr == "isize") {
+        return getUsizeType(context);
     } else if (typeStr == "bool") {
         return llvm::Type::getInt1Ty(context);
     } else if (typeStr == "str") {
         // String slice: struct { ptr: *u8, len: usize }
         llvm::Type* i8PtrType = llvm::PointerType::get(llvm::Type::getInt8Ty(context), 0);
-        llvm::Type* usizeType = llvm::Type::getInt64Ty(context); // usize as i64
+        llvm::Type* usizeType = getUsizeType(context);
         return llvm::StructType::get(context, {i8PtrType, usizeType});
     } else if (typeStr.substr(0, 2) == "[]") {
         // Slice type: []T -> struct { ptr: *T, len: usize }
         std::string elementType = typeStr.substr(2); // Remove "[]"
         llvm::Type* elemType = getTypeFromString(elementType, context);
         llvm::Type* elemPtrType = llvm::PointerType::get(elemType, 0);
-        llvm::Type* usizeType = llvm::Type::getInt64Ty(context); // usize as i64
+        llvm::Type* usizeType = getUsizeType(context);
         return llvm::StructType::get(context, {elemPtrType, usizeType});
+    } else if (typeStr[0] == '!') {
+        // Error union: !T -> struct { value: T, error_code: u16 }
+        std::string name = "error_union." + typeStr.substr(1);
+        if (llvm::StructType* existing = llvm::StructType::getTypeByName(context, name)) {
+            return existing;
+        }
+        llvm::Type* payloadType = getTypeFromString(typeStr.substr(1), context);
+        return llvm::StructType::create(context, {payloadType, llvm::Type::getInt16Ty(context)}, name);
+    } else if (llvm::StructType* structType = llvm::StructType::getTypeByName(context, typeStr)) {
+        // User-defined struct, registered by StructAST::codegen
+        return structType;
     }
     throw std::runtime_error("Unknown type: " + typeStr);
 }
+
+bool isErrorUnionType(llvm::Type* type) {
+    llvm::StructType* structType = llvm::dyn_cast<llvm::StructType>(type);
+    return structType && structType->hasName() && structType->getName().str().rfind("error_union.", 0) == 0;
+}
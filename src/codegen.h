@@ -11,8 +11,20 @@
 #include <string>
 #include "llvm/IR/Type.h"
 #include "llvm/IR/LLVMContext.h"
+#include "target.h"
+
+// Target and CPU model the code is generated for (set by the driver, on the
+// generating thread, before codegen)
+extern thread_local const jam::Target* CodegenTarget;
+extern thread_local const jam::CPUModel* CodegenCPU;
 
 // Helper function to get LLVM type from type string
 llvm::Type* getTypeFromString(const std::string& typeStr, llvm::LLVMContext& context);
 
+// usize/isize: integer type as wide as a pointer on the codegen target
+llvm::Type* getUsizeType(llvm::LLVMContext& context);
+
+// Error unions (!T) are lowered to a named struct { T, u16 error_code } returned in registers
+bool isErrorUnionType(llvm::Type* type);
+
 #endif // CODEGEN_H
@@ -0,0 +1,310 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "hotreload.h"
+#include "ast.h"
+#include "codegen.h"
+#include "jit.h"
+#include "lexer.h"
+#include "multiversion.h"
+#include "parser.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/FileSystem.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+namespace jam {
+
+HotReloadJIT::HotReloadJIT(const Target& target, const CPUModel& cpu, OptLevel level)
+    : target_(target), cpu_(cpu), level_(level) {
+    auto builder = JIT::getTargetMachineBuilder(cpu, level);
+    llvm::Triple triple = builder.getTargetTriple();
+
+    jit_ = unwrapOrThrow(llvm::orc::LLJITBuilder().setJITTargetMachineBuilder(std::move(builder)).create(),
+                         "Failed to create JIT");
+    auto generator = unwrapOrThrow(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+                                       jit_->getDataLayout().getGlobalPrefix()),
+                                   "Failed to load host symbols");
+    jit_->getMainJITDylib().addGenerator(std::move(generator));
+
+    stubs_ = llvm::orc::createLocalIndirectStubsManagerBuilder(triple)();
+    if (level != OptLevel::O0) {
+        targetMachine_ = JIT::createTargetMachine(cpu, level);
+    }
+}
+
+HotReloadJIT::~HotReloadJIT() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (watcher_.joinable()) {
+        watcher_.join();
+    }
+}
+
+// Split the token stream into top-level items and key each fn and struct
+// by name. Line numbers are left out, so an edit only marks the items whose
+// own tokens changed, not everything below it.
+std::map<std::string, std::string> HotReloadJIT::fingerprint(const std::vector<Token>& tokens) {
+    std::map<std::string, std::string> items;
+    size_t i = 0;
+    while (i < tokens.size() && tokens[i].type != TOK_EOF) {
+        std::string name;
+        std::string text;
+        int braces = 0;
+        int parens = 0;
+        for (; i < tokens.size() && tokens[i].type != TOK_EOF; i++) {
+            const Token& token = tokens[i];
+            if (name.empty() && (token.type == TOK_FN || token.type == TOK_STRUCT) && i + 1 < tokens.size()) {
+                name = (token.type == TOK_STRUCT ? "struct " : "") + tokens[i + 1].lexeme;
+            }
+            text += std::to_string(token.type) + ":" + token.lexeme + "\x1f";
+
+            if (token.type == TOK_OPEN_PAREN) parens++;
+            else if (token.type == TOK_CLOSE_PAREN) parens--;
+            else if (token.type == TOK_OPEN_BRACE) braces++;
+            else if (token.type == TOK_CLOSE_BRACE && --braces == 0) break;
+            else if (token.type == TOK_SEMI && braces == 0 && parens == 0) break;
+        }
+        i++;
+        if (!name.empty()) {
+            items[name] = text;
+        }
+    }
+    return items;
+}
+
+void HotReloadJIT::addModule(std::unique_ptr<llvm::Module> module, std::unique_ptr<llvm::LLVMContext> context,
+                             const std::string& source) {
+    Lexer lexer(source);
+    std::vector<Token> tokens = lexer.scanTokens();
+    Parser parser(tokens);
+    for (const auto& function : parser.parse()) {
+        prototypes_[function->Name] = {function->Args, function->ReturnType};
+    }
+    fingerprints_ = fingerprint(tokens);
+    layouts_ = CurrentLayouts;
+
+    context_ = llvm::orc::ThreadSafeContext(std::move(context));
+    install(std::move(module));
+}
+
+// Move every body in the module to <name>.v<generation> behind a
+// declaration of <name>, which resolves to the function's stub, then compile
+// the module and point the stubs at the new bodies
+void HotReloadJIT::install(std::unique_ptr<llvm::Module> module) {
+    std::string suffix = ".v" + std::to_string(generation_++);
+    std::vector<std::string> names;
+    {
+        auto lock = context_.getLock();
+        std::vector<llvm::Function*> defined;
+        for (auto& func : *module) {
+            if (!func.isDeclaration()) {
+                func.setLinkage(llvm::Function::ExternalLinkage);
+                defined.push_back(&func);
+            }
+        }
+        for (llvm::Function* func : defined) {
+            std::string name = func->getName().str();
+            func->setName(name + suffix);
+            llvm::Function* stub = llvm::Function::Create(func->getFunctionType(), llvm::Function::ExternalLinkage,
+                                                          name, module.get());
+            stub->setCallingConv(func->getCallingConv());
+            func->replaceAllUsesWith(stub);
+            names.push_back(name);
+        }
+
+        if (llvm::verifyModule(*module, &llvm::errs())) {
+            throw std::runtime_error("generated invalid code");
+        }
+        if (targetMachine_) {
+            OptimizationOptions options;
+            options.level = level_;
+            optimizeModule(*module, targetMachine_.get(), options);
+        }
+    }
+
+    llvm::orc::SymbolMap stubSymbols;
+    for (const auto& name : names) {
+        if (stubs_->findStub(name, false)) {
+            continue;
+        }
+        throwIfError(stubs_->createStub(name, llvm::orc::ExecutorAddr(), llvm::JITSymbolFlags::Exported),
+                     "Failed to create stub for " + name);
+        stubSymbols[jit_->mangleAndIntern(name)] = llvm::orc::ExecutorSymbolDef(
+            stubs_->findStub(name, false).getAddress(), llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable);
+    }
+    if (!stubSymbols.empty()) {
+        throwIfError(jit_->getMainJITDylib().define(llvm::orc::absoluteSymbols(std::move(stubSymbols))),
+                     "Failed to define stubs");
+    }
+
+    throwIfError(jit_->addIRModule(llvm::orc::ThreadSafeModule(std::move(module), context_)),
+                 "Failed to add module to JIT");
+
+    // Compile everything before repointing any stub
+    std::vector<llvm::orc::ExecutorAddr> bodies;
+    for (const auto& name : names) {
+        bodies.push_back(unwrapOrThrow(jit_->lookup(name + suffix), "Failed to compile " + name));
+    }
+    for (size_t i = 0; i < names.size(); i++) {
+        throwIfError(stubs_->updatePointer(names[i], bodies[i]), "Failed to update stub for " + names[i]);
+    }
+}
+
+void* HotReloadJIT::lookup(const std::string& name) {
+    auto symbol = unwrapOrThrow(jit_->lookup(name), "JIT symbol lookup failed");
+    return symbol.toPtr<void*>();
+}
+
+std::vector<std::string> HotReloadJIT::reload(const std::string& source) {
+    Lexer lexer(source);
+    std::vector<Token> tokens = lexer.scanTokens();
+    Parser parser(tokens);
+    std::vector<std::unique_ptr<FunctionAST>> functions = parser.parse();
+    if (!parser.getCImports().empty() || !parser.getImports().empty()) {
+        throw std::runtime_error("imports are not supported with --hot-reload");
+    }
+    std::map<std::string, std::string> fingerprints = fingerprint(tokens);
+
+    std::vector<StructAST*> newStructs;
+    for (auto& structDecl : parser.getStructs()) {
+        auto it = fingerprints_.find("struct " + structDecl->Name);
+        if (it == fingerprints_.end()) {
+            newStructs.push_back(structDecl.get());
+        } else if (it->second != fingerprints["struct " + structDecl->Name]) {
+            throw std::runtime_error("struct " + structDecl->Name + " changed; restart to apply");
+        }
+    }
+
+    std::set<FunctionAST*> changed;
+    std::vector<std::string> names;
+    for (auto& function : functions) {
+        auto it = fingerprints_.find(function->Name);
+        if (function->isExtern || (it != fingerprints_.end() && it->second == fingerprints[function->Name])) {
+            continue;
+        }
+        auto previous = prototypes_.find(function->Name);
+        if (previous != prototypes_.end() &&
+            (previous->second.args != function->Args || previous->second.returnType != function->ReturnType)) {
+            throw std::runtime_error("signature of " + function->Name + " changed; restart to apply");
+        }
+        changed.insert(function.get());
+        names.push_back(function->Name);
+    }
+    if (changed.empty() && newStructs.empty()) {
+        fingerprints_ = std::move(fingerprints);
+        return names;
+    }
+
+    std::unique_ptr<llvm::Module> module;
+    {
+        auto lock = context_.getLock();
+        llvm::LLVMContext& context = *context_.getContext();
+        module = std::make_unique<llvm::Module>("jam.reload." + std::to_string(generation_), context);
+        module->setDataLayout(jit_->getDataLayout());
+        module->setTargetTriple(jit_->getTargetTriple().str());
+
+        // Codegen state is per thread; this runs on the watcher
+        CurrentLayouts = layouts_;
+        CodegenTarget = &target_;
+        CodegenCPU = &cpu_;
+
+        llvm::IRBuilder<> builder(context);
+        std::map<std::string, llvm::Value*> namedValues;
+        for (StructAST* structDecl : newStructs) {
+            structDecl->codegen(module.get(), *layouts_);
+        }
+        // Unchanged functions are only declared; they resolve to their stubs
+        for (auto& function : functions) {
+            if (function->isExtern) {
+                function->codegen(builder, module.get(), namedValues);
+            } else if (!changed.count(function.get())) {
+                FunctionAST decl(function->Name, function->Args, function->ReturnType, {}, /*isExtern=*/true);
+                decl.codegen(builder, module.get(), namedValues);
+            }
+        }
+        for (auto& function : functions) {
+            if (changed.count(function.get())) {
+                function->codegen(builder, module.get(), namedValues);
+            }
+        }
+        lowerTargetClones(*module, target_, /*forJIT=*/true);
+    }
+    install(std::move(module));
+
+    for (FunctionAST* function : changed) {
+        prototypes_[function->Name] = {function->Args, function->ReturnType};
+    }
+    fingerprints_ = std::move(fingerprints);
+    return names;
+}
+
+void HotReloadJIT::watch(const std::string& path) {
+    watcher_ = std::thread([this, path] { runWatcher(path); });
+}
+
+static llvm::sys::TimePoint<> getModificationTime(const std::string& path) {
+    llvm::sys::fs::file_status status;
+    if (llvm::sys::fs::status(path, status)) {
+        return {};
+    }
+    return status.getLastModificationTime();
+}
+
+void HotReloadJIT::runWatcher(std::string path) {
+    llvm::sys::TimePoint<> lastModified = getModificationTime(path);
+    // Edits from here on are picked up
+    std::cerr << "[hot-reload] watching " << path << std::endl;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait_for(lock, std::chrono::milliseconds(PollMilliseconds), [this] { return stopping_; });
+            if (stopping_) {
+                return;
+            }
+        }
+
+        llvm::sys::TimePoint<> modified = getModificationTime(path);
+        if (modified == lastModified) {
+            continue;
+        }
+        lastModified = modified;
+
+        auto start = std::chrono::steady_clock::now();
+        try {
+            std::ifstream file(path);
+            std::stringstream buffer;
+            buffer << file.rdbuf();
+            std::vector<std::string> names = reload(buffer.str());
+            if (names.empty()) {
+                continue;
+            }
+
+            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start);
+            std::cerr << "[hot-reload] ";
+            for (size_t i = 0; i < names.size(); i++) {
+                std::cerr << (i ? ", " : "") << names[i];
+            }
+            std::cerr << " in " << elapsed.count() / 1000.0 << " ms" << std::endl;
+        } catch (const std::exception& e) {
+            // The program keeps running its current code
+            std::cerr << "[hot-reload] " << path << ": " << e.what() << std::endl;
+        }
+    }
+}
+
+} // namespace jam
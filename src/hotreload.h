@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef HOTRELOAD_H
+#define HOTRELOAD_H
+
+#include "layout.h"
+#include "optimizer.h"
+#include "target.h"
+#include "token.h"
+#include "llvm/ExecutionEngine/Orc/IndirectionUtils.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Target/TargetMachine.h"
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace jam {
+
+// JIT for --run --hot-reload.
+//
+// Every function is compiled eagerly and called only through an ORC
+// indirection stub, so no call is inlined or bound to a particular body.
+// A background thread polls the source file; when it changes, only the
+// functions whose tokens changed are re-parsed into a new module (the rest
+// are declarations resolving to their stubs), compiled, and swapped in by
+// repointing their stubs. Each stub update is a single pointer store, so a
+// call runs either the old body or the new one; frames already running the
+// old body finish there. The process, and any state it holds, is untouched.
+//
+// Changing a struct or the signature of an existing function would break
+// code compiled against the old one, so such edits are reported and not
+// applied; the program keeps running its current code.
+class HotReloadJIT {
+public:
+    // Polling interval of the file watcher
+    static constexpr unsigned PollMilliseconds = 50;
+
+    HotReloadJIT(const Target& target, const CPUModel& cpu, OptLevel level);
+    ~HotReloadJIT();
+
+    // Compile the unoptimized program module generated from source. Later
+    // reloads generate code with the calling thread's CurrentLayouts.
+    void addModule(std::unique_ptr<llvm::Module> module, std::unique_ptr<llvm::LLVMContext> context,
+                   const std::string& source);
+
+    // Stub address of a function
+    void* lookup(const std::string& name);
+
+    // Start reloading path whenever it changes
+    void watch(const std::string& path);
+
+    // Recompile the functions of source that changed since the last load.
+    // Returns their names; throws std::runtime_error if nothing was applied.
+    std::vector<std::string> reload(const std::string& source);
+
+private:
+    struct Prototype {
+        std::vector<std::pair<std::string, std::string>> args;
+        std::string returnType;
+    };
+
+    Target target_;
+    CPUModel cpu_;
+    OptLevel level_;
+    LayoutEngine* layouts_ = nullptr;
+    std::unique_ptr<llvm::orc::LLJIT> jit_;
+    std::unique_ptr<llvm::orc::IndirectStubsManager> stubs_;
+    std::unique_ptr<llvm::TargetMachine> targetMachine_;
+    llvm::orc::ThreadSafeContext context_;
+    unsigned generation_ = 0;
+
+    // Tokens of each top-level fn and struct ("struct Name"), and function
+    // signatures, as of the last load
+    std::map<std::string, std::string> fingerprints_;
+    std::map<std::string, Prototype> prototypes_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    std::thread watcher_;
+
+    static std::map<std::string, std::string> fingerprint(const std::vector<Token>& tokens);
+    void install(std::unique_ptr<llvm::Module> module);
+    void runWatcher(std::string path);
+};
+
+} // namespace jam
+
+#endif // HOTRELOAD_H
@@ -0,0 +1,433 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "interface.h"
+#include <stdexcept>
+
+namespace jam {
+
+void InterfaceWriter::writeU32(uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        writeU8(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+void InterfaceWriter::writeI64(int64_t value) {
+    uint64_t bits = static_cast<uint64_t>(value);
+    for (int i = 0; i < 8; i++) {
+        writeU8(static_cast<uint8_t>(bits >> (8 * i)));
+    }
+}
+
+void InterfaceWriter::writeString(const std::string& value) {
+    writeU32(static_cast<uint32_t>(value.size()));
+    bytes_ += value;
+}
+
+void InterfaceWriter::writeNode(InterfaceNode kind) {
+    writeU8(static_cast<uint8_t>(kind));
+    nodes_++;
+}
+
+void InterfaceWriter::writeExpr(const ExprAST* expr) {
+    if (!expr) {
+        writeU8(static_cast<uint8_t>(InterfaceNode::Null));
+        return;
+    }
+    expr->serialize(*this);
+}
+
+void InterfaceWriter::writeBody(const std::vector<std::unique_ptr<ExprAST>>& body) {
+    writeU32(static_cast<uint32_t>(body.size()));
+    for (const auto& expr : body) {
+        writeExpr(expr.get());
+    }
+}
+
+namespace {
+
+// Bounds-checked cursor over a serialized interface
+class InterfaceReader {
+public:
+    InterfaceReader(llvm::StringRef bytes, size_t position = 0) : bytes_(bytes), position_(position) {}
+
+    size_t position() const { return position_; }
+
+    uint8_t readU8() {
+        need(1);
+        return static_cast<uint8_t>(bytes_[position_++]);
+    }
+
+    uint32_t readU32() {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) {
+            value |= static_cast<uint32_t>(readU8()) << (8 * i);
+        }
+        return value;
+    }
+
+    int64_t readI64() {
+        uint64_t value = 0;
+        for (int i = 0; i < 8; i++) {
+            value |= static_cast<uint64_t>(readU8()) << (8 * i);
+        }
+        return static_cast<int64_t>(value);
+    }
+
+    std::string readString() {
+        uint32_t size = readU32();
+        need(size);
+        std::string value = bytes_.substr(position_, size).str();
+        position_ += size;
+        return value;
+    }
+
+    std::unique_ptr<ExprAST> readExpr();
+    std::vector<std::unique_ptr<ExprAST>> readBody();
+
+private:
+    llvm::StringRef bytes_;
+    size_t position_;
+
+    void need(size_t size) const {
+        if (size > bytes_.size() - position_) {
+            throw std::runtime_error("truncated module interface");
+        }
+    }
+};
+
+std::vector<std::unique_ptr<ExprAST>> InterfaceReader::readBody() {
+    uint32_t count = readU32();
+    std::vector<std::unique_ptr<ExprAST>> body;
+    for (uint32_t i = 0; i < count; i++) {
+        body.push_back(readExpr());
+    }
+    return body;
+}
+
+std::unique_ptr<ExprAST> InterfaceReader::readExpr() {
+    switch (static_cast<InterfaceNode>(readU8())) {
+        case InterfaceNode::Null:
+            return nullptr;
+        case InterfaceNode::Number:
+            return std::make_unique<NumberExprAST>(readI64());
+        case InterfaceNode::Boolean:
+            return std::make_unique<BooleanExprAST>(readU8() != 0);
+        case InterfaceNode::StringLiteral:
+            return std::make_unique<StringLiteralExprAST>(readString());
+        case InterfaceNode::TargetConstant:
+            return std::make_unique<TargetConstantExprAST>(readString());
+        case InterfaceNode::Variable:
+            return std::make_unique<VariableExprAST>(readString());
+        case InterfaceNode::FieldAccess: {
+            std::string name = readString();
+            std::vector<std::string> fields(readU32());
+            for (auto& field : fields) {
+                field = readString();
+            }
+            return std::make_unique<FieldAccessExprAST>(std::move(name), std::move(fields));
+        }
+        case InterfaceNode::Binary: {
+            std::string op = readString();
+            auto lhs = readExpr();
+            auto rhs = readExpr();
+            return std::make_unique<BinaryExprAST>(std::move(op), std::move(lhs), std::move(rhs));
+        }
+        case InterfaceNode::Call: {
+            std::string callee = readString();
+            return std::make_unique<CallExprAST>(std::move(callee), readBody());
+        }
+        case InterfaceNode::Return:
+            return std::make_unique<ReturnExprAST>(readExpr());
+        case InterfaceNode::Error:
+            return std::make_unique<ErrorExprAST>(readExpr());
+        case InterfaceNode::Try:
+            return std::make_unique<TryExprAST>(readExpr());
+        case InterfaceNode::Catch: {
+            auto operand = readExpr();
+            auto fallback = readExpr();
+            return std::make_unique<CatchExprAST>(std::move(operand), std::move(fallback));
+        }
+        case InterfaceNode::VarDecl: {
+            std::string name = readString();
+            std::string type = readString();
+            bool isConst = readU8() != 0;
+            return std::make_unique<VarDeclAST>(std::move(name), std::move(type), isConst, readExpr());
+        }
+        case InterfaceNode::If: {
+            auto condition = readExpr();
+            auto thenBody = readBody();
+            auto elseBody = readBody();
+            return std::make_unique<IfExprAST>(std::move(condition), std::move(thenBody), std::move(elseBody));
+        }
+        case InterfaceNode::While: {
+            auto condition = readExpr();
+            return std::make_unique<WhileExprAST>(std::move(condition), readBody());
+        }
+        case InterfaceNode::For: {
+            std::string name = readString();
+            auto start = readExpr();
+            auto end = readExpr();
+            return std::make_unique<ForExprAST>(std::move(name), std::move(start), std::move(end), readBody());
+        }
+        case InterfaceNode::Break:
+            return std::make_unique<BreakExprAST>();
+        case InterfaceNode::Continue:
+            return std::make_unique<ContinueExprAST>();
+    }
+    throw std::runtime_error("unknown node in module interface");
+}
+
+} // namespace
+
+std::string ModuleInterface::write(const std::vector<std::string>& imports,
+                                   const std::vector<std::unique_ptr<StructAST>>& structs,
+                                   const std::vector<std::unique_ptr<FunctionAST>>& functions) {
+    std::set<std::string> exportNames;
+    uint32_t exportCount = 0;
+    bool definesMain = false;
+    for (const auto& function : functions) {
+        if (function->isExport) {
+            exportNames.insert(function->Name);
+            exportCount++;
+        }
+        if (function->Name == "main" && !function->isExtern) {
+            definesMain = true;
+        }
+    }
+
+    InterfaceWriter out;
+    out.bytes() = "JAMI";
+    out.writeU32(Version);
+    out.writeU32(definesMain ? 1 : 0);
+
+    out.writeU32(static_cast<uint32_t>(imports.size()));
+    for (const auto& path : imports) {
+        out.writeString(path);
+    }
+
+    out.writeU32(static_cast<uint32_t>(structs.size()));
+    for (const auto& structDecl : structs) {
+        out.writeString(structDecl->Name);
+        out.writeU8(structDecl->isExtern ? 1 : 0);
+        out.writeU32(static_cast<uint32_t>(structDecl->Fields.size()));
+        for (const auto& field : structDecl->Fields) {
+            out.writeString(field.name);
+            out.writeString(field.type);
+            out.writeU8(field.isHot ? 1 : 0);
+        }
+    }
+
+    // A body is kept if it is small and every function it calls is visible
+    // to the importer: another export, or a builtin
+    std::string bodies;
+    out.writeU32(exportCount);
+    for (const auto& function : functions) {
+        if (!function->isExport) {
+            continue;
+        }
+        out.writeString(function->Name);
+        out.writeU32(static_cast<uint32_t>(function->Args.size()));
+        for (const auto& [name, type] : function->Args) {
+            out.writeString(name);
+            out.writeString(type);
+        }
+        out.writeString(function->ReturnType);
+
+        InterfaceWriter body;
+        body.writeBody(function->Body);
+        bool inlinable = function->TargetClones.empty() && body.nodeCount() <= InlineNodeLimit;
+        for (const auto& callee : body.callees()) {
+            inlinable = inlinable && exportNames.count(callee);
+        }
+        if (inlinable) {
+            out.writeU32(static_cast<uint32_t>(bodies.size()));
+            out.writeU32(static_cast<uint32_t>(body.bytes().size()));
+            bodies += body.bytes();
+        } else {
+            out.writeU32(0);
+            out.writeU32(0);
+        }
+    }
+    return out.bytes() + bodies;
+}
+
+std::unique_ptr<ModuleInterface> ModuleInterface::read(std::unique_ptr<llvm::MemoryBuffer> buffer) {
+    auto interface = std::make_unique<ModuleInterface>();
+    if (buffer->getBuffer().substr(0, 4) != "JAMI") {
+        throw std::runtime_error("not a module interface");
+    }
+    InterfaceReader in(buffer->getBuffer(), 4);
+    if (in.readU32() != Version) {
+        throw std::runtime_error("module interface from another jam version");
+    }
+    interface->definesMain_ = (in.readU32() & 1) != 0;
+
+    uint32_t imports = in.readU32();
+    for (uint32_t i = 0; i < imports; i++) {
+        interface->imports_.push_back(in.readString());
+    }
+
+    uint32_t structs = in.readU32();
+    for (uint32_t i = 0; i < structs; i++) {
+        std::string name = in.readString();
+        bool isExtern = in.readU8() != 0;
+        std::vector<FieldDecl> fields(in.readU32());
+        for (auto& field : fields) {
+            field.name = in.readString();
+            field.type = in.readString();
+            field.isHot = in.readU8() != 0;
+        }
+        interface->structs_.push_back(std::make_unique<StructAST>(std::move(name), std::move(fields), isExtern));
+    }
+
+    uint32_t exports = in.readU32();
+    for (uint32_t i = 0; i < exports; i++) {
+        Export function;
+        function.name = in.readString();
+        function.args.resize(in.readU32());
+        for (auto& [name, type] : function.args) {
+            name = in.readString();
+            type = in.readString();
+        }
+        function.returnType = in.readString();
+        function.bodyOffset = in.readU32();
+        function.bodySize = in.readU32();
+        interface->exports_.push_back(std::move(function));
+    }
+
+    interface->bodiesStart_ = in.position();
+    for (const auto& function : interface->exports_) {
+        if (function.bodySize &&
+            interface->bodiesStart_ + function.bodyOffset + function.bodySize > buffer->getBufferSize()) {
+            throw std::runtime_error("truncated module interface");
+        }
+    }
+    interface->buffer_ = std::move(buffer);
+    return interface;
+}
+
+std::unique_ptr<FunctionAST> ModuleInterface::loadInlineBody(const Export& function) const {
+    if (!function.bodySize) {
+        return nullptr;
+    }
+    InterfaceReader in(getBytes().substr(bodiesStart_ + function.bodyOffset, function.bodySize));
+    return std::make_unique<FunctionAST>(function.name, function.args, function.returnType, in.readBody(),
+                                         /*isExtern=*/false, /*isExport=*/true);
+}
+
+} // namespace jam
+
+// Each node writes its kind followed by its operands, in constructor order
+
+void NumberExprAST::serialize(jam::InterfaceWriter& W) const {
+    W.writeNode(jam::InterfaceNode::Number);
+    W.writeI64(Val);
+}
+
+void BooleanExprAST::serialize(jam::InterfaceWriter& W) const {
+    W.writeNode(jam::InterfaceNode::Boolean);
+    W.writeU8(Val ? 1 : 0);
+}
+
+void StringLiteralExprAST::serialize(jam::InterfaceWriter& W) const {
+    W.writeNode(jam::InterfaceNode::StringLiteral);
+    W.writeString(Val);
+}
+
+void TargetConstantExprAST::serialize(jam::InterfaceWriter& W) const {
+    W.writeNode(jam::InterfaceNode::TargetConstant);
+    W.writeString(Name);
+}
+
+void VariableExprAST::serialize(jam::InterfaceWriter& W) const {
+    W.writeNode(jam::InterfaceNode::Variable);
+    W.writeString(Name);
+}
+
+void FieldAccessExprAST::serialize(jam::InterfaceWriter& W) const {
+    W.writeNode(jam::InterfaceNode::FieldAccess);
+    W.writeString(VarName);
+    W.writeU32(static_cast<uint32_t>(Fields.size()));
+    for (const auto& field : Fields) {
+        W.writeString(field);
+    }
+}
+
+void BinaryExprAST::serialize(jam::InterfaceWriter& W) const {
+    W.writeNode(jam::InterfaceNode::Binary);
+    W.writeString(Op);
+    W.writeExpr(LHS.get());
+    W.writeExpr(RHS.get());
+}
+
+void CallExprAST::serialize(jam::InterfaceWriter& W) const {
+    W.writeNode(jam::InterfaceNode::Call);
+    W.writeString(Callee);
+    W.writeBody(Args);
+    if (!isPrintCall()) {
+        W.noteCall(Callee);
+    }
+}
+
+void ReturnExprAST::serialize(jam::InterfaceWriter& W) const {
+    W.writeNode(jam::InterfaceNode::Return);
+    W.writeExpr(RetVal.get());
+}
+
+void ErrorExprAST::serialize(jam::InterfaceWriter& W) const {
+    W.writeNode(jam::InterfaceNode::Error);
+    W.writeExpr(Code.get());
+}
+
+void TryExprAST::serialize(jam::InterfaceWriter& W) const {
+    W.writeNode(jam::InterfaceNode::Try);
+    W.writeExpr(Operand.get());
+}
+
+void CatchExprAST::serialize(jam::InterfaceWriter& W) const {
+    W.writeNode(jam::InterfaceNode::Catch);
+    W.writeExpr(Operand.get());
+    W.writeExpr(Fallback.get());
+}
+
+void VarDeclAST::serialize(jam::InterfaceWriter& W) const {
+    W.writeNode(jam::InterfaceNode::VarDecl);
+    W.writeString(Name);
+    W.writeString(Type);
+    W.writeU8(IsConst ? 1 : 0);
+    W.writeExpr(Init.get());
+}
+
+void IfExprAST::serialize(jam::InterfaceWriter& W) const {
+    W.writeNode(jam::InterfaceNode::If);
+    W.writeExpr(Condition.get());
+    W.writeBody(ThenBody);
+    W.writeBody(ElseBody);
+}
+
+void WhileExprAST::serialize(jam::InterfaceWriter& W) const {
+    W.writeNode(jam::InterfaceNode::While);
+    W.writeExpr(Condition.get());
+    W.writeBody(Body);
+}
+
+void ForExprAST::serialize(jam::InterfaceWriter& W) const {
+    W.writeNode(jam::InterfaceNode::For);
+    W.writeString(VarName);
+    W.writeExpr(Start.get());
+    W.writeExpr(End.get());
+    W.writeBody(Body);
+}
+
+void BreakExprAST::serialize(jam::InterfaceWriter& W) const {
+    W.writeNode(jam::InterfaceNode::Break);
+}
+
+void ContinueExprAST::serialize(jam::InterfaceWriter& W) const {
+    W.writeNode(jam::InterfaceNode::Continue);
+}
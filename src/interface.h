@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef INTERFACE_H
+#define INTERFACE_H
+
+#include "ast.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace jam {
+
+// Node kinds in serialized function bodies
+enum class InterfaceNode : uint8_t {
+    Null,
+    Number,
+    Boolean,
+    StringLiteral,
+    TargetConstant,
+    Variable,
+    FieldAccess,
+    Binary,
+    Call,
+    Return,
+    Error,
+    Try,
+    Catch,
+    VarDecl,
+    If,
+    While,
+    For,
+    Break,
+    Continue,
+};
+
+// Serializes a module interface. Each ExprAST node writes itself through
+// serialize(); the writer records which functions a body calls and how
+// large it is, which decides whether it can be inlined by importers.
+class InterfaceWriter {
+public:
+    void writeU8(uint8_t value) { bytes_.push_back(static_cast<char>(value)); }
+    void writeU32(uint32_t value);
+    void writeI64(int64_t value);
+    void writeString(const std::string& value);
+    void writeNode(InterfaceNode kind);
+    void writeExpr(const ExprAST* expr);
+    void writeBody(const std::vector<std::unique_ptr<ExprAST>>& body);
+    void noteCall(const std::string& callee) { callees_.insert(callee); }
+
+    std::string& bytes() { return bytes_; }
+    std::set<std::string>& callees() { return callees_; }
+    size_t& nodeCount() { return nodes_; }
+
+private:
+    std::string bytes_;
+    std::set<std::string> callees_;
+    size_t nodes_ = 0;
+};
+
+// What importers of a module see, stored as a .jami file: the modules it
+// imports, its structs, the prototypes of its export fns, and the bodies of
+// the small export fns that call nothing but other exports, so importers
+// can inline them. Jam has no module-level constants, so there are none to
+// record.
+//
+// The file is read in place (the buffer is usually mmap'ed). Opening it
+// decodes only the import list, structs and prototypes; a body is decoded
+// when an importer asks for it, which it only does when optimizing.
+//
+// Format, little-endian:
+//   "JAMI" u32:version u32:flags(bit 0: defines main)
+//   u32:imports  { str:path }
+//   u32:structs  { str:name u8:extern u32:fields { str:name str:type u8:hot } }
+//   u32:exports  { str:name u32:args { str:name str:type } str:return
+//                  u32:bodyOffset u32:bodySize }       (size 0: no body)
+//   bodies, at offsets from the end of the export table
+// where str is u32:length followed by the bytes.
+class ModuleInterface {
+public:
+    static constexpr uint32_t Version = 1;
+
+    // Bodies with more nodes than this are left out
+    static constexpr size_t InlineNodeLimit = 64;
+
+    struct Export {
+        std::string name;
+        std::vector<std::pair<std::string, std::string>> args;
+        std::string returnType;
+        uint32_t bodyOffset = 0;
+        uint32_t bodySize = 0;
+    };
+
+    // Serialize the interface of a parsed module
+    static std::string write(const std::vector<std::string>& imports,
+                             const std::vector<std::unique_ptr<StructAST>>& structs,
+                             const std::vector<std::unique_ptr<FunctionAST>>& functions);
+
+    // Open a serialized interface; throws std::runtime_error if it is
+    // malformed or from another version
+    static std::unique_ptr<ModuleInterface> read(std::unique_ptr<llvm::MemoryBuffer> buffer);
+
+    const std::vector<std::string>& getImports() const { return imports_; }
+    const std::vector<std::unique_ptr<StructAST>>& getStructs() const { return structs_; }
+    const std::vector<Export>& getExports() const { return exports_; }
+    bool definesMain() const { return definesMain_; }
+
+    // The serialized bytes, which identify the interface in cache keys
+    llvm::StringRef getBytes() const { return buffer_->getBuffer(); }
+
+    // Decode an export with its body (an export fn, not extern), or nullptr
+    // if it has no inlinable body
+    std::unique_ptr<FunctionAST> loadInlineBody(const Export& function) const;
+
+private:
+    std::unique_ptr<llvm::MemoryBuffer> buffer_;
+    size_t bodiesStart_ = 0;
+    std::vector<std::string> imports_;
+    std::vector<std::unique_ptr<StructAST>> structs_;
+    std::vector<Export> exports_;
+    bool definesMain_ = false;
+};
+
+} // namespace jam
+
+#endif // INTERFACE_H
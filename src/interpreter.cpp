@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "interpreter.h"
+#include "lexer.h"
+#include "parser.h"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define JAM_COMPUTED_GOTO 1
+#endif
+
+namespace jam {
+
+static inline uint64_t maskTo(uint64_t value, unsigned bits) {
+    return bits >= 64 ? value : value & ((uint64_t(1) << bits) - 1);
+}
+
+static inline int64_t signExtend(uint64_t value, unsigned bits) {
+    return bits >= 64 ? static_cast<int64_t>(value) : static_cast<int64_t>(value << (64 - bits)) >> (64 - bits);
+}
+
+static const char* toString(uint64_t slice) {
+    const char* text = reinterpret_cast<const char*>(slice);
+    if (!text) {
+        throw std::runtime_error("printing an empty slice");
+    }
+    return text;
+}
+
+uint64_t interpret(const BytecodeProgram& program, unsigned entry, const std::vector<uint64_t>& args) {
+    struct Frame {
+        const BytecodeFunction* function;
+        const Instruction* ip;
+        uint64_t* regs;
+        uint16_t result;
+    };
+
+    // Left uninitialized so only the pages a program touches are faulted in
+    std::unique_ptr<uint64_t[]> stack(new uint64_t[InterpreterStackRegisters]);
+    uint64_t* const stackEnd = stack.get() + InterpreterStackRegisters;
+    std::vector<Frame> frames;
+
+    const BytecodeFunction* function = &program.functions.at(entry);
+    if (args.size() != function->numParams) {
+        throw std::runtime_error("Incorrect number of arguments passed to " + function->name);
+    }
+    uint64_t* regs = stack.get();
+    std::copy(args.begin(), args.end(), regs);
+    const Instruction* ip = function->code.data();
+    const uint64_t* constants = function->constants.data();
+
+#ifdef JAM_COMPUTED_GOTO
+    // One indirect jump per handler, so each gets its own branch history
+    static const void* const dispatchTable[] = {
+        &&op_LoadK, &&op_Move, &&op_Add, &&op_Eq, &&op_Ne, &&op_Ult, &&op_Ule, &&op_Ugt, &&op_Uge,
+        &&op_Slt, &&op_IntCast, &&op_Jump, &&op_JumpIfZero, &&op_Call, &&op_Ret, &&op_Print,
+        &&op_Println, &&op_Unreachable,
+    };
+    static_assert(sizeof(dispatchTable) / sizeof(dispatchTable[0]) == static_cast<size_t>(Op::Count),
+                  "dispatch table out of sync with Op");
+#define DISPATCH() goto *dispatchTable[static_cast<uint8_t>(ip->op)]
+#define CASE(name) op_##name:
+#else
+#define DISPATCH() goto dispatch
+#define CASE(name) case Op::name:
+#endif
+#define NEXT() do { ++ip; DISPATCH(); } while (0)
+
+#ifdef JAM_COMPUTED_GOTO
+    DISPATCH();
+    {
+#else
+dispatch:
+    switch (ip->op) {
+#endif
+    CASE(LoadK) regs[ip->a] = constants[ip->wide()]; NEXT();
+    CASE(Move) regs[ip->a] = regs[ip->b]; NEXT();
+    CASE(Add) regs[ip->a] = maskTo(regs[ip->b] + regs[ip->c], ip->bits); NEXT();
+    CASE(Eq) regs[ip->a] = regs[ip->b] == regs[ip->c]; NEXT();
+    CASE(Ne) regs[ip->a] = regs[ip->b] != regs[ip->c]; NEXT();
+    CASE(Ult) regs[ip->a] = regs[ip->b] < regs[ip->c]; NEXT();
+    CASE(Ule) regs[ip->a] = regs[ip->b] <= regs[ip->c]; NEXT();
+    CASE(Ugt) regs[ip->a] = regs[ip->b] > regs[ip->c]; NEXT();
+    CASE(Uge) regs[ip->a] = regs[ip->b] >= regs[ip->c]; NEXT();
+    CASE(Slt) regs[ip->a] = signExtend(regs[ip->b], ip->bits) < signExtend(regs[ip->c], ip->bits); NEXT();
+    CASE(IntCast) regs[ip->a] = maskTo(regs[ip->b], ip->bits); NEXT();
+    CASE(Jump) ip = function->code.data() + ip->wide(); DISPATCH();
+    CASE(JumpIfZero) {
+        if (regs[ip->a] == 0) {
+            ip = function->code.data() + ip->wide();
+            DISPATCH();
+        }
+        NEXT();
+    }
+    CASE(Call) {
+        // The callee's registers start above all of the caller's
+        const BytecodeFunction* callee = &program.functions[ip->b];
+        uint64_t* calleeRegs = regs + function->numRegisters;
+        if (calleeRegs + callee->numRegisters > stackEnd) {
+            throw std::runtime_error("stack overflow in " + callee->name);
+        }
+        for (unsigned i = 0; i < ip->c; i++) {
+            calleeRegs[i] = regs[ip->a + i];
+        }
+        frames.push_back({function, ip + 1, regs, ip->a});
+        function = callee;
+        regs = calleeRegs;
+        ip = function->code.data();
+        constants = function->constants.data();
+        DISPATCH();
+    }
+    CASE(Ret) {
+        if (frames.empty()) {
+            return ip->b ? regs[ip->a] : 0;
+        }
+        const Frame& caller = frames.back();
+        for (unsigned i = 0; i < ip->b; i++) {
+            caller.regs[caller.result + i] = regs[ip->a + i];
+        }
+        function = caller.function;
+        ip = caller.ip;
+        regs = caller.regs;
+        constants = function->constants.data();
+        frames.pop_back();
+        DISPATCH();
+    }
+    CASE(Print) regs[ip->a] = static_cast<uint32_t>(std::printf("%s", toString(regs[ip->b]))); NEXT();
+    CASE(Println) regs[ip->a] = static_cast<uint32_t>(std::puts(toString(regs[ip->b]))); NEXT();
+    CASE(Unreachable) throw std::runtime_error("reached the end of non-void function " + function->name);
+#ifndef JAM_COMPUTED_GOTO
+    case Op::Count:
+        break;
+#endif
+    }
+
+#undef NEXT
+#undef CASE
+#undef DISPATCH
+    throw std::runtime_error("invalid bytecode in " + function->name);
+}
+
+int runInterpreter(const std::string& source, LayoutEngine& layouts, std::ostream& out) {
+    try {
+        Lexer lexer(source);
+        Parser parser(lexer.scanTokens());
+        std::vector<std::unique_ptr<FunctionAST>> functions = parser.parse();
+        if (!parser.getCImports().empty()) {
+            throw std::runtime_error("--interp cannot run @cImport");
+        }
+        for (auto& structDecl : parser.getStructs()) {
+            layouts.addStruct(structDecl->Name, structDecl->Fields, structDecl->isExtern);
+        }
+
+        BytecodeCompiler compiler(layouts);
+        BytecodeProgram program = compiler.compile(functions);
+        int mainIndex = program.findFunction("main");
+        if (mainIndex < 0) {
+            std::cerr << "Error: No main function found" << std::endl;
+            return 1;
+        }
+
+        out << "Running Jam program..." << std::endl;
+        uint64_t exitCode = interpret(program, static_cast<unsigned>(mainIndex));
+        std::fflush(stdout);
+
+        const BytecodeFunction& main = program.functions[mainIndex];
+        if (main.numResults != 0) {
+            out << std::endl << "Program exited with code: " << exitCode << std::endl;
+        } else {
+            out << std::endl << "Program completed successfully." << std::endl;
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::fflush(stdout);
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+} // namespace jam
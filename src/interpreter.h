@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include "bytecode.h"
+#include "layout.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace jam {
+
+// Registers shared by all frames (8 MB); running out is a stack overflow
+constexpr size_t InterpreterStackRegisters = size_t(1) << 20;
+
+// Run functions[function] with the given parameter registers and return its
+// first result register (0 for void). Dispatch uses computed goto where the
+// compiler supports it, a switch otherwise. Throws std::runtime_error on a
+// stack overflow or when control reaches the end of a non-void function.
+uint64_t interpret(const BytecodeProgram& program, unsigned function, const std::vector<uint64_t>& args = {});
+
+// jam --interp: lex, parse, compile to bytecode and run main, without
+// initializing LLVM. Prints the same messages as --run. Returns the exit status.
+int runInterpreter(const std::string& source, LayoutEngine& layouts, std::ostream& out);
+
+} // namespace jam
+
+#endif // INTERPRETER_H
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "jit.h"
+#include "version.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/ExecutionEngine/Orc/CompileUtils.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/Support/Error.h"
+#include <stdexcept>
+
+namespace jam {
+
+llvm::orc::JITTargetMachineBuilder JIT::getTargetMachineBuilder(const CPUModel& cpu, OptLevel level) {
+    auto builder = unwrapOrThrow(llvm::orc::JITTargetMachineBuilder::detectHost(), "Failed to detect host target");
+    builder.setCPU(cpu.name);
+    builder.addFeatures(cpu.getFeatureList());
+    builder.setCodeGenOptLevel(toCodeGenOptLevel(level));
+    return builder;
+}
+
+JIT::JIT(const CPUModel& cpu, OptLevel level, llvm::ObjectCache* cache, unsigned compileThreads) {
+    auto builder = getTargetMachineBuilder(cpu, level);
+
+    jit_ = unwrapOrThrow(llvm::orc::LLLazyJITBuilder()
+                      .setJITTargetMachineBuilder(std::move(builder))
+                      .setNumCompileThreads(compileThreads)
+                      .setCompileFunctionCreator([cache, compileThreads](llvm::orc::JITTargetMachineBuilder JTMB)
+                              -> llvm::Expected<std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
+                          // A TargetMachine can't be shared between compile threads
+                          if (compileThreads > 0) {
+                              return std::make_unique<llvm::orc::ConcurrentIRCompiler>(std::move(JTMB), cache);
+                          }
+                          auto TM = JTMB.createTargetMachine();
+                          if (!TM) {
+                              return TM.takeError();
+                          }
+                          return std::make_unique<llvm::orc::TMOwningSimpleCompiler>(std::move(*TM), cache);
+                      })
+                      .create(),
+                  "Failed to create JIT");
+
+    // Resolve libc and other host symbols from the running process
+    auto generator = unwrapOrThrow(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+                                jit_->getDataLayout().getGlobalPrefix()),
+                            "Failed to load host symbols");
+    jit_->getMainJITDylib().addGenerator(std::move(generator));
+
+    if (compileThreads > 0) {
+        enableSpeculation();
+    }
+}
+
+// Every function the lazy layer compiles arrives as its own small module, in
+// which the functions it calls are declarations. Before compiling it, ask for
+// those callees' bodies without waiting; the lookup materializes them on the
+// compile threads. The bodies live in the lazy layer's implementation dylib
+// (the stubs are in main), and names that aren't there (libc) are skipped.
+void JIT::enableSpeculation() {
+    llvm::orc::ExecutionSession& session = jit_->getExecutionSession();
+    std::string implName = jit_->getMainJITDylib().getName() + ".impl";
+
+    jit_->getIRTransformLayer().setTransform(
+        [this, &session, implName](llvm::orc::ThreadSafeModule module, llvm::orc::MaterializationResponsibility&)
+            -> llvm::Expected<llvm::orc::ThreadSafeModule> {
+            llvm::orc::JITDylib* impl = session.getJITDylibByName(implName);
+            if (!impl) {
+                return std::move(module);
+            }
+
+            llvm::orc::SymbolLookupSet callees;
+            module.withModuleDo([&](llvm::Module& m) {
+                for (auto& func : m) {
+                    if (func.isDeclaration() && !func.isIntrinsic() && !func.use_empty()) {
+                        callees.add(jit_->mangleAndIntern(func.getName()),
+                                    llvm::orc::SymbolLookupFlags::WeaklyReferencedSymbol);
+                    }
+                }
+            });
+            if (!callees.empty()) {
+                session.lookup(
+                    llvm::orc::LookupKind::Static,
+                    llvm::orc::makeJITDylibSearchOrder({impl}, llvm::orc::JITDylibLookupFlags::MatchAllSymbols),
+                    std::move(callees), llvm::orc::SymbolState::Ready,
+                    [](llvm::Expected<llvm::orc::SymbolMap> result) {
+                        // Speculation is best effort; a real call reports its own errors
+                        llvm::consumeError(result.takeError());
+                    },
+                    llvm::orc::NoDependenciesToRegister);
+            }
+            return std::move(module);
+        });
+}
+
+std::unique_ptr<llvm::TargetMachine> JIT::createTargetMachine(const CPUModel& cpu, OptLevel level) {
+    return unwrapOrThrow(getTargetMachineBuilder(cpu, level).createTargetMachine(), "Failed to create target machine");
+}
+
+std::string JIT::getCacheSalt(const CPUModel& cpu, OptLevel level) {
+    auto builder = unwrapOrThrow(llvm::orc::JITTargetMachineBuilder::detectHost(), "Failed to detect host target");
+    return builder.getTargetTriple().str() + ";" + cpu.name + ";" + cpu.features + ";O" +
+           std::to_string(static_cast<int>(level)) + ";jam " JAM_VERSION ";llvm " LLVM_VERSION_STRING;
+}
+
+const llvm::DataLayout& JIT::getDataLayout() const {
+    return jit_->getDataLayout();
+}
+
+void JIT::addModule(std::unique_ptr<llvm::Module> module, std::unique_ptr<llvm::LLVMContext> context) {
+    throwIfError(jit_->addLazyIRModule(llvm::orc::ThreadSafeModule(std::move(module), std::move(context))),
+          "Failed to add module to JIT");
+}
+
+void JIT::addModule(llvm::orc::ThreadSafeModule module) {
+    throwIfError(jit_->addLazyIRModule(std::move(module)), "Failed to add module to JIT");
+}
+
+void JIT::addCompiledModule(llvm::orc::ThreadSafeModule module) {
+    throwIfError(jit_->addIRModule(std::move(module)), "Failed to add module to JIT");
+}
+
+void JIT::defineSymbol(const std::string& name, void* address) {
+    llvm::orc::SymbolMap symbols;
+    symbols[jit_->mangleAndIntern(name)] = llvm::orc::ExecutorSymbolDef(
+        llvm::orc::ExecutorAddr::fromPtr(address), llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable);
+    throwIfError(jit_->getMainJITDylib().define(llvm::orc::absoluteSymbols(std::move(symbols))),
+                 "Failed to define " + name);
+}
+
+void* JIT::lookup(const std::string& name) {
+    auto symbol = unwrapOrThrow(jit_->lookup(name), "JIT symbol lookup failed");
+    return symbol.toPtr<void*>();
+}
+
+} // namespace jam
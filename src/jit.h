@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef JIT_H
+#define JIT_H
+
+#include "optimizer.h"
+#include "target.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Error.h"
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace jam {
+
+// ORC reports failures through llvm::Error; jam throws std::runtime_error
+template <typename T>
+T unwrapOrThrow(llvm::Expected<T> value, const std::string& what) {
+    if (!value) {
+        throw std::runtime_error(what + ": " + llvm::toString(value.takeError()));
+    }
+    return std::move(*value);
+}
+
+inline void throwIfError(llvm::Error error, const std::string& what) {
+    if (error) {
+        throw std::runtime_error(what + ": " + llvm::toString(std::move(error)));
+    }
+}
+
+// ORC-based JIT used by --run.
+//
+// Modules are added lazily: every function is reached through a lazy
+// reexport stub and only compiled the first time it is called, so a large
+// script that touches a few functions starts without compiling the rest.
+// Symbols not defined by Jam code (libc, the C runtime) resolve against the
+// host process. With an ObjectCache, compiled objects are looked up before
+// running the backend and stored after it.
+//
+// With compile threads, lazy compiles run on a thread pool, and compiling a
+// function speculatively requests its direct callees in the background, so
+// their first calls usually find machine code already there.
+class JIT {
+public:
+    // Throws std::runtime_error if the host target cannot be set up
+    JIT(const CPUModel& cpu, OptLevel level, llvm::ObjectCache* cache = nullptr, unsigned compileThreads = 0);
+
+    // Salt for cache keys: everything besides the IR that changes the object code
+    static std::string getCacheSalt(const CPUModel& cpu, OptLevel level);
+
+    // Host target with the selected CPU, features and backend optimization level
+    static llvm::orc::JITTargetMachineBuilder getTargetMachineBuilder(const CPUModel& cpu, OptLevel level);
+
+    // Target machine matching the JIT's code generation, for running IR passes
+    static std::unique_ptr<llvm::TargetMachine> createTargetMachine(const CPUModel& cpu, OptLevel level);
+
+    // Data layout modules must use before they are added
+    const llvm::DataLayout& getDataLayout() const;
+
+    // Add a module; its functions compile on first call
+    void addModule(std::unique_ptr<llvm::Module> module, std::unique_ptr<llvm::LLVMContext> context);
+
+    // Add a module whose context is shared with other modules (the REPL)
+    void addModule(llvm::orc::ThreadSafeModule module);
+
+    // Add a module compiled up front, without lazy stubs: lookup returns the
+    // function itself (libjam, where calls should cost no more than native)
+    void addCompiledModule(llvm::orc::ThreadSafeModule module);
+
+    // Define a symbol at a fixed address in the host process (libjam host functions)
+    void defineSymbol(const std::string& name, void* address);
+
+    // Address of a JIT'd symbol, compiling it if needed. Throws if undefined.
+    void* lookup(const std::string& name);
+
+private:
+    std::unique_ptr<llvm::orc::LLLazyJIT> jit_;
+
+    void enableSpeculation();
+};
+
+} // namespace jam
+
+#endif // JIT_H
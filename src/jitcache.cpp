@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "jitcache.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Chrono.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/SHA256.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+namespace jam {
+
+JITCache::JITCache(std::string directory, std::string salt, uint64_t maxBytes, bool verbose)
+    : directory_(std::move(directory)), salt_(std::move(salt)), maxBytes_(maxBytes), verbose_(verbose) {
+    llvm::sys::fs::create_directories(directory_);
+}
+
+std::string JITCache::getDefaultDirectory() {
+    llvm::SmallString<256> path;
+    if (!llvm::sys::path::cache_directory(path)) {
+        return "";
+    }
+    llvm::sys::path::append(path, "jam");
+    return std::string(path);
+}
+
+// Lazily compiled functions arrive one small module at a time; name them in reports
+static std::string describe(const llvm::Module* module) {
+    std::string names;
+    for (const auto& func : *module) {
+        if (!func.isDeclaration()) {
+            if (!names.empty()) names += ", ";
+            names += func.getName().str();
+        }
+    }
+    return names.empty() ? module->getModuleIdentifier() : names;
+}
+
+std::string JITCache::getPath(const llvm::Module* module) const {
+    std::string data = salt_;
+    data.push_back('\0');
+    llvm::raw_string_ostream out(data);
+    llvm::WriteBitcodeToFile(*module, out);
+    out.flush();
+
+    std::string key = llvm::toHex(llvm::SHA256::hash(llvm::arrayRefFromStringRef(data)), /*LowerCase=*/true);
+    llvm::SmallString<256> path(directory_);
+    llvm::sys::path::append(path, key + ".o");
+    return std::string(path);
+}
+
+std::unique_ptr<llvm::MemoryBuffer> JITCache::getObject(const llvm::Module* module) {
+    std::string path = getPath(module);
+    auto buffer = llvm::MemoryBuffer::getFile(path);
+    if (!buffer) {
+        misses_++;
+        if (verbose_) {
+            std::cerr << "[jit-cache] miss: " << describe(module) << std::endl;
+        }
+        return nullptr;
+    }
+
+    // Mark as recently used for eviction
+    touchCacheFile(path);
+    hits_++;
+    if (verbose_) {
+        std::cerr << "[jit-cache] hit: " << describe(module) << std::endl;
+    }
+    return std::move(*buffer);
+}
+
+void JITCache::notifyObjectCompiled(const llvm::Module* module, llvm::MemoryBufferRef object) {
+    std::string path = getPath(module);
+
+    // Write to a unique file and rename, so concurrent runs never see a partial object
+    int fd;
+    llvm::SmallString<256> tempPath;
+    if (llvm::sys::fs::createUniqueFile(path + ".tmp-%%%%%%", fd, tempPath)) {
+        return;
+    }
+    {
+        llvm::raw_fd_ostream out(fd, /*shouldClose=*/true);
+        out << object.getBuffer();
+    }
+    if (llvm::sys::fs::rename(tempPath, path)) {
+        llvm::sys::fs::remove(tempPath);
+        return;
+    }
+
+    evict();
+}
+
+void JITCache::evict() {
+    evictCacheFiles(directory_, ".o", maxBytes_, "jit-cache", verbose_);
+}
+
+void touchCacheFile(const std::string& path) {
+    int fd;
+    if (!llvm::sys::fs::openFileForWrite(path, fd, llvm::sys::fs::CD_OpenExisting, llvm::sys::fs::OF_Append)) {
+        llvm::sys::fs::setLastAccessAndModificationTime(fd, std::chrono::system_clock::now());
+        llvm::sys::Process::SafelyCloseFileDescriptor(fd);
+    }
+}
+
+void evictCacheFiles(const std::string& directory, const std::string& extension, uint64_t maxBytes,
+                     const char* tag, bool verbose) {
+    struct Entry {
+        std::string path;
+        uint64_t size;
+        llvm::sys::TimePoint<> lastUsed;
+    };
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+
+    std::error_code EC;
+    for (llvm::sys::fs::directory_iterator it(directory, EC), end; it != end && !EC; it.increment(EC)) {
+        if (llvm::sys::path::extension(it->path()) != extension) {
+            continue;
+        }
+        llvm::sys::fs::file_status status;
+        if (llvm::sys::fs::status(it->path(), status)) {
+            continue;
+        }
+        entries.push_back({it->path(), status.getSize(), status.getLastModificationTime()});
+        total += status.getSize();
+    }
+    if (total <= maxBytes) {
+        return;
+    }
+
+    // Oldest first
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.lastUsed < b.lastUsed;
+    });
+    for (const auto& entry : entries) {
+        if (total <= maxBytes) {
+            break;
+        }
+        if (!llvm::sys::fs::remove(entry.path)) {
+            total -= entry.size;
+            if (verbose) {
+                std::cerr << "[" << tag << "] evicted " << llvm::sys::path::filename(entry.path).str() << std::endl;
+            }
+        }
+    }
+}
+
+} // namespace jam
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef JITCACHE_H
+#define JITCACHE_H
+
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace jam {
+
+// Mark a cache file as recently used
+void touchCacheFile(const std::string& path);
+
+// Remove the least recently used files with the given extension from
+// directory until it holds at most maxBytes of them. tag prefixes the
+// verbose report, e.g. "jit-cache".
+void evictCacheFiles(const std::string& directory, const std::string& extension, uint64_t maxBytes,
+                     const char* tag, bool verbose);
+
+// On-disk cache of JIT-compiled objects, shared by every --run invocation.
+//
+// Each object is keyed by a SHA-256 of the module's bitcode plus a salt
+// naming everything else that affects code generation (target triple, CPU,
+// features, optimization level, jam and LLVM versions), so a hit can be
+// linked without running the backend. Files are touched on every hit and
+// the least recently used ones are evicted once the directory exceeds
+// maxBytes.
+class JITCache : public llvm::ObjectCache {
+public:
+    static constexpr uint64_t DefaultMaxBytes = 256ull * 1024 * 1024;
+
+    JITCache(std::string directory, std::string salt, uint64_t maxBytes = DefaultMaxBytes, bool verbose = false);
+
+    // $XDG_CACHE_HOME/jam, usually ~/.cache/jam
+    static std::string getDefaultDirectory();
+
+    void notifyObjectCompiled(const llvm::Module* module, llvm::MemoryBufferRef object) override;
+    std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module* module) override;
+
+    unsigned getHits() const { return hits_; }
+    unsigned getMisses() const { return misses_; }
+
+private:
+    std::string directory_;
+    std::string salt_;
+    uint64_t maxBytes_;
+    bool verbose_;
+    // Updated from compile threads under --run -j
+    std::atomic<unsigned> hits_ = 0;
+    std::atomic<unsigned> misses_ = 0;
+
+    std::string getPath(const llvm::Module* module) const;
+    void evict();
+};
+
+} // namespace jam
+
+#endif // JITCACHE_H
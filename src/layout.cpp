@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "layout.h"
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+
+namespace jam {
+
+static uint64_t alignTo(uint64_t value, uint64_t align) {
+    return (value + align - 1) / align * align;
+}
+
+int StructLayout::getFieldIndex(const std::string& fieldName) const {
+    for (size_t i = 0; i < fields.size(); i++) {
+        if (fields[i].name == fieldName) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+uint64_t StructLayout::getPadding() const {
+    uint64_t used = 0;
+    for (const auto& field : fields) {
+        used += field.size;
+    }
+    return size - used;
+}
+
+// Place fields in their current order and size the struct
+static void assignOffsets(StructLayout& layout) {
+    uint64_t offset = 0;
+    layout.align = 1;
+    for (auto& field : layout.fields) {
+        offset = alignTo(offset, field.align);
+        field.offset = offset;
+        offset += field.size;
+        layout.align = std::max(layout.align, field.align);
+    }
+    layout.size = alignTo(offset, layout.align);
+}
+
+bool StructLayout::isReordered() const {
+    for (size_t i = 0; i < fields.size(); i++) {
+        if (fields[i].declIndex != i) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t LayoutEngine::getTypeSize(const std::string& type) const {
+    if (type == "u8" || type == "i8" || type == "bool") {
+        return 1;
+    } else if (type == "u16" || type == "i16") {
+        return 2;
+    } else if (type == "u32" || type == "i32") {
+        return 4;
+    } else if (type == "usize" || type == "isize") {
+        return target_.getPointerSize();
+    } else if (type == "str" || type.substr(0, 2) == "[]") {
+        // Slice: { ptr, usize }
+        return 2 * static_cast<uint64_t>(target_.getPointerSize());
+    } else if (const StructLayout* layout = lookup(type)) {
+        return layout->size;
+    }
+    throw std::runtime_error("Unknown type: " + type);
+}
+
+uint64_t LayoutEngine::getTypeAlignment(const std::string& type) const {
+    if (type == "str" || type.substr(0, 2) == "[]") {
+        return target_.getPointerAlignment();
+    } else if (const StructLayout* layout = lookup(type)) {
+        return layout->align;
+    }
+    // Primitive types are naturally aligned
+    return getTypeSize(type);
+}
+
+const StructLayout& LayoutEngine::addStruct(const std::string& name, const std::vector<FieldDecl>& fields, bool isExtern) {
+    if (layouts_.count(name)) {
+        throw std::runtime_error("Redefinition of struct: " + name);
+    }
+
+    StructLayout layout;
+    layout.name = name;
+    layout.isExtern = isExtern;
+
+    for (unsigned i = 0; i < fields.size(); i++) {
+        FieldLayout field;
+        field.name = fields[i].name;
+        field.type = fields[i].type;
+        field.size = getTypeSize(fields[i].type);
+        field.align = getTypeAlignment(fields[i].type);
+        field.declIndex = i;
+        field.isHot = fields[i].isHot;
+        layout.fields.push_back(field);
+    }
+
+    if (!isExtern) {
+        // Largest alignment first removes padding; stable keeps source order for ties
+        std::stable_sort(layout.fields.begin(), layout.fields.end(), [](const FieldLayout& a, const FieldLayout& b) {
+            return a.align > b.align;
+        });
+    }
+    assignOffsets(layout);
+
+    // Hot fields only move forward when that order leaves one outside the
+    // first cache line, since moving them can cost padding
+    bool hotSpills = std::any_of(layout.fields.begin(), layout.fields.end(), [&](const FieldLayout& field) {
+        return field.isHot && field.offset + field.size > cacheLineSize_;
+    });
+    if (!isExtern && hotSpills) {
+        std::stable_partition(layout.fields.begin(), layout.fields.end(), [](const FieldLayout& field) {
+            return field.isHot;
+        });
+        assignOffsets(layout);
+    }
+
+    order_.push_back(name);
+    return layouts_[name] = std::move(layout);
+}
+
+const StructLayout* LayoutEngine::lookup(const std::string& name) const {
+    auto it = layouts_.find(name);
+    return it == layouts_.end() ? nullptr : &it->second;
+}
+
+void LayoutEngine::print(std::ostream& os) const {
+    os << "Type Layouts (cache line: " << cacheLineSize_ << " bytes):" << std::endl;
+    if (order_.empty()) {
+        os << "  (no struct types)" << std::endl;
+    }
+
+    for (const auto& name : order_) {
+        const StructLayout& layout = layouts_.at(name);
+        os << std::endl;
+        os << "  " << (layout.isExtern ? "extern struct " : "struct ") << layout.name
+           << ": size " << layout.size << ", align " << layout.align
+           << ", padding " << layout.getPadding();
+        if (layout.isReordered()) {
+            os << " (reordered)";
+        }
+        os << std::endl;
+
+        uint64_t offset = 0;
+        uint64_t line = 0;
+        for (const auto& field : layout.fields) {
+            if (field.offset > offset) {
+                os << "    " << std::setw(6) << offset << "  [" << (field.offset - offset) << " bytes padding]" << std::endl;
+            }
+            if (field.offset / cacheLineSize_ > line) {
+                line = field.offset / cacheLineSize_;
+                os << "    ------ cache line " << line << " ------" << std::endl;
+            }
+            os << "    " << std::setw(6) << field.offset << "  " << field.name << ": " << field.type
+               << " (size " << field.size << ", align " << field.align << ")";
+            if (field.isHot) {
+                os << " @hot";
+                if (field.offset + field.size > cacheLineSize_) {
+                    os << " [outside first cache line]";
+                }
+            }
+            if (field.size > 0 && (field.offset + field.size - 1) / cacheLineSize_ > line) {
+                os << " [crosses cache line]";
+            }
+            os << std::endl;
+            offset = field.offset + field.size;
+        }
+        if (layout.size > offset) {
+            os << "    " << std::setw(6) << offset << "  [" << (layout.size - offset) << " bytes tail padding]" << std::endl;
+        }
+    }
+}
+
+} // namespace jam
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include "target.h"
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace jam {
+
+// Field as written in the source
+struct FieldDecl {
+    std::string name;
+    std::string type;
+    bool isHot = false;  // @hot: keep in the first cache line
+};
+
+// Field after layout
+struct FieldLayout {
+    std::string name;
+    std::string type;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    uint64_t align = 1;
+    unsigned declIndex = 0;  // position in the source declaration
+    bool isHot = false;
+};
+
+// Final struct layout, fields in memory order
+struct StructLayout {
+    std::string name;
+    bool isExtern = false;  // C layout, declaration order preserved
+    uint64_t size = 0;
+    uint64_t align = 1;
+    std::vector<FieldLayout> fields;
+
+    // Physical field index (LLVM struct element), -1 if not found
+    int getFieldIndex(const std::string& fieldName) const;
+    uint64_t getPadding() const;
+    bool isReordered() const;
+};
+
+// Computes struct layouts for a target.
+// Non-extern structs are free to reorder their fields: they are sorted by
+// decreasing alignment to remove padding, and @hot fields move to the front
+// only if that order would leave one outside the first cache line.
+// Extern structs keep the declared order so they match the C ABI.
+class LayoutEngine {
+public:
+    explicit LayoutEngine(const Target& target, unsigned cacheLineSize = 64)
+        : target_(target), cacheLineSize_(cacheLineSize) {}
+
+    const StructLayout& addStruct(const std::string& name, const std::vector<FieldDecl>& fields, bool isExtern);
+    const StructLayout* lookup(const std::string& name) const;
+
+    uint64_t getTypeSize(const std::string& type) const;
+    uint64_t getTypeAlignment(const std::string& type) const;
+    unsigned getCacheLineSize() const { return cacheLineSize_; }
+
+    // Human-readable report used by --print-layouts
+    void print(std::ostream& os) const;
+
+private:
+    Target target_;
+    unsigned cacheLineSize_;
+    std::map<std::string, StructLayout> layouts_;
+    std::vector<std::string> order_;  // declaration order for reports
+};
+
+} // namespace jam
+
+#endif // LAYOUT_H
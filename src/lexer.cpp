@@ -6,6 +6,7 @@
  */
 
 #include "lexer.h"
+#include "timing.h"
 #include <stdexcept>
 #include <iostream>
 
@@ -119,9 +120,19 @@ void Lexer::identifier() {
         addToken(TOK_EXTERN, text);
     } else if (text == "export") {
         addToken(TOK_EXPORT, text);
+    } else if (text == "struct") {
+        addToken(TOK_STRUCT, text);
+    } else if (text == "try") {
+        addToken(TOK_TRY, text);
+    } else if (text == "catch") {
+        addToken(TOK_CATCH, text);
+    } else if (text == "error") {
+        addToken(TOK_ERROR, text);
+    } else if (text == "import") {
+        addToken(TOK_IMPORT, text);
     } else if (text == "print" || text == "println" || text == "printf") {
         addToken(TOK_IDENTIFIER, text); // Treat as regular identifiers for now
-    } else if (text == "u8" || text == "u16" || text == "u32" || text == "i8" || text == "i16" || text == "i32" || text == "bool" || text == "str") {
+    } else if (text == "u8" || text == "u16" || text == "u32" || text == "i8" || text == "i16" || text == "i32" || text == "usize" || text == "isize" || text == "bool" || text == "str") {
         addToken(TOK_TYPE, text);
     } else {
         addToken(TOK_IDENTIFIER, text);
@@ -165,6 +176,7 @@ void Lexer::stringLiteral() {
 }
 
 std::vector<Token> Lexer::scanTokens() {
+    jam::TimeScope timing("Lex");
     while (!isAtEnd()) {
         skipWhitespace();
         if (isAtEnd()) break;
@@ -181,6 +193,8 @@ std::vector<Token> Lexer::scanTokens() {
             case ',': addToken(TOK_COMMA, ","); break;
             case ';': addToken(TOK_SEMI, ";"); break;
             case ':': addToken(TOK_COLON, ":"); break;
+            case '.': addToken(TOK_DOT, "."); break;
+            case '@': addToken(TOK_AT, "@"); break;
             case '+': addToken(TOK_PLUS, "+"); break;
             case '"': stringLiteral(); break;
             
@@ -196,7 +210,7 @@ std::vector<Token> Lexer::scanTokens() {
                 if (match('=')) {
                     addToken(TOK_NOT_EQUAL, "!=");
                 } else {
-                    std::cerr << "Unexpected character at line " << line << ": " << c << std::endl;
+                    addToken(TOK_BANG, "!");
                 }
                 break;
             
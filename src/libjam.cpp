@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "libjam.h"
+#include "session.h"
+#include "llvm/Support/TargetSelect.h"
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+
+struct jam_session {
+    std::unique_ptr<jam::Session> session;
+};
+
+namespace {
+
+thread_local std::string lastError;
+
+// C callers get a status code; the message is kept for jam_last_error
+template <typename F>
+int reportErrors(F&& body) {
+    try {
+        body();
+        lastError.clear();
+        return 0;
+    } catch (const std::exception& e) {
+        lastError = e.what();
+        return 1;
+    }
+}
+
+void initializeLLVM() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        llvm::InitializeNativeTarget();
+        llvm::InitializeNativeTargetAsmPrinter();
+        llvm::InitializeNativeTargetAsmParser();
+    });
+}
+
+} // namespace
+
+extern "C" {
+
+jam_session* jam_session_create(int opt_level) {
+    if (opt_level < 0 || opt_level > 3) {
+        lastError = "optimization level must be 0-3";
+        return nullptr;
+    }
+    initializeLLVM();
+
+    // Embedded code only runs on this machine, so target its CPU
+    auto handle = std::make_unique<jam_session>();
+    int status = reportErrors([&] {
+        handle->session = std::make_unique<jam::Session>(jam::Target::getHostTarget(), jam::CPUModel::getHostCPU(),
+                                                         static_cast<jam::OptLevel>(opt_level),
+                                                         jam::Session::Compilation::Eager);
+    });
+    return status == 0 ? handle.release() : nullptr;
+}
+
+void jam_session_destroy(jam_session* session) {
+    delete session;
+}
+
+int jam_compile_source(jam_session* session, const char* source) {
+    return reportErrors([&] { session->session->addDefinitions(source); });
+}
+
+int jam_register_host_fn(jam_session* session, const char* name, void* fn, const char* signature) {
+    return reportErrors([&] { session->session->addHostFunction(name, fn, signature); });
+}
+
+void* jam_lookup(jam_session* session, const char* name) {
+    void* address = nullptr;
+    reportErrors([&] { address = session->session->lookup(name); });
+    return address;
+}
+
+const char* jam_last_error(void) {
+    return lastError.c_str();
+}
+
+} // extern "C"
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef LIBJAM_H
+#define LIBJAM_H
+
+/*
+ * libjam: embed Jam as a compiled extension language.
+ *
+ * A session owns one JIT. Source added with jam_compile_source is compiled
+ * for the host CPU as soon as it is added, so jam_lookup returns the native
+ * entry point itself: calling it costs the same as any indirect call, with
+ * no stub or marshalling in between. Integer and bool parameters and
+ * results map directly onto C types, so the pointer is cast to the matching
+ * C function type.
+ *
+ *     jam_session* s = jam_session_create(2);
+ *     jam_register_host_fn(s, "host_log", (void*)&host_log, "(code: u32)");
+ *     jam_compile_source(s, "fn twice(x: u32) -> u32 { host_log(x); return x + x; }");
+ *     uint32_t (*twice)(uint32_t) = JAM_LOOKUP(s, "twice", uint32_t (*)(uint32_t));
+ *
+ * Functions returned by jam_lookup may be called from any thread for the
+ * lifetime of the session. Compiling and registering are thread-safe but
+ * serialized per session; separate sessions compile in parallel. A failing call returns
+ * nonzero (or NULL) and jam_last_error describes why.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct jam_session jam_session;
+
+/* New session; opt_level is 0-3 as for -O. Returns NULL on failure. */
+jam_session* jam_session_create(int opt_level);
+
+/* Free the session and all code compiled in it */
+void jam_session_destroy(jam_session* session);
+
+/* Compile fn, extern fn and struct definitions. Returns 0 on success. */
+int jam_compile_source(jam_session* session, const char* source);
+
+/*
+ * Make a host function callable from Jam code compiled afterwards. signature
+ * uses Jam syntax, e.g. "(a: u32, b: u32) -> u32" or "(code: u32)" for
+ * no result. Returns 0 on success.
+ */
+int jam_register_host_fn(jam_session* session, const char* name, void* fn, const char* signature);
+
+/* Native address of a compiled Jam function, or NULL if it is not defined */
+void* jam_lookup(jam_session* session, const char* name);
+
+/* Message for the last failed call on this thread, or "" */
+const char* jam_last_error(void);
+
+#ifdef __cplusplus
+}
+
+/* Typed lookup: jam_lookup_as<uint32_t(uint32_t)>(session, "twice") */
+template <typename Fn>
+Fn* jam_lookup_as(jam_session* session, const char* name) {
+    return reinterpret_cast<Fn*>(jam_lookup(session, name));
+}
+#endif
+
+#define JAM_LOOKUP(session, name, type) ((type)jam_lookup((session), (name)))
+
+#endif /* LIBJAM_H */
@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "linker.h"
+#include "timing.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/VersionTuple.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <optional>
+
+#ifdef JAM_HAVE_LLD
+#include "lld/Common/Driver.h"
+LLD_HAS_DRIVER(elf)
+#endif
+
+namespace jam {
+
+std::string getClangLinkCommand(const LinkJob& job) {
+    std::string cmd = "clang";
+    if (job.optimization.lto != LTOMode::None) {
+        // Let the linker optimize Jam and C code together
+        cmd += std::string(" -flto=") + getLTOModeName(job.optimization.lto) + " -fuse-ld=lld";
+        cmd += " -O" + std::to_string(static_cast<int>(job.optimization.level));
+        if (job.cpu.name != "generic") {
+            // C inputs are compiled to bitcode by the same clang invocation
+            cmd += " -march=" + job.cpu.name;
+        }
+    }
+    for (const auto& object : job.objects) {
+        cmd += " " + object;
+    }
+    for (const auto& input : job.inputs) {
+        cmd += " " + input;
+    }
+    cmd += " -o " + job.output;
+    if (job.profileRuntime) {
+        // Pulls in the compiler-rt profile runtime that writes the .profraw
+        cmd += " -fprofile-generate";
+    }
+    return cmd;
+}
+
+#ifdef JAM_HAVE_LLD
+namespace {
+
+// Where the C runtime of a target lives, as the gcc/clang drivers would
+// find it for a dynamically linked executable. Linux targets don't require
+// PIE (Target::requiresPIE) and jam emits objects with the static
+// relocation model, so executables are linked at a fixed address.
+struct ELFToolchain {
+    std::string emulation;      // -m
+    std::string dynamicLinker;
+    std::string crtDirectory;   // crt1.o, crti.o, crtn.o, libc
+    std::string gccDirectory;   // crtbegin.o, crtend.o, libgcc
+};
+
+bool hasFile(const std::string& directory, const char* name) {
+    llvm::SmallString<256> path(directory);
+    llvm::sys::path::append(path, name);
+    return llvm::sys::fs::exists(path);
+}
+
+std::string joinPath(const std::string& directory, const char* name) {
+    llvm::SmallString<256> path(directory);
+    llvm::sys::path::append(path, name);
+    return std::string(path);
+}
+
+// The newest version directory under /usr/lib*/gcc/<triple>/ for this
+// architecture that has crtbegin.o
+std::string findGCCDirectory(const char* archName) {
+    std::string best;
+    llvm::VersionTuple bestVersion;
+    for (const char* root : {"/usr/lib/gcc", "/usr/lib64/gcc"}) {
+        std::error_code EC;
+        for (llvm::sys::fs::directory_iterator triple(root, EC), end; !EC && triple != end; triple.increment(EC)) {
+            if (!llvm::StringRef(llvm::sys::path::filename(triple->path())).starts_with(archName)) {
+                continue;
+            }
+            std::error_code versionEC;
+            for (llvm::sys::fs::directory_iterator version(triple->path(), versionEC);
+                 !versionEC && version != end; version.increment(versionEC)) {
+                llvm::VersionTuple parsed;
+                if (parsed.tryParse(llvm::sys::path::filename(version->path())) ||
+                    !hasFile(version->path(), "crtbegin.o")) {
+                    continue;
+                }
+                if (best.empty() || parsed > bestVersion) {
+                    best = version->path();
+                    bestVersion = parsed;
+                }
+            }
+        }
+    }
+    return best;
+}
+
+std::optional<ELFToolchain> findToolchain(const Target& target) {
+    if (target.os != OS::Linux) {
+        return std::nullopt;
+    }
+    bool musl = llvm::StringRef(target.getLibCName()) == "musl";
+    if (!musl && llvm::StringRef(target.getLibCName()) != "glibc") {
+        return std::nullopt;
+    }
+
+    ELFToolchain toolchain;
+    const char* archName;
+    std::string multiarch;
+    switch (target.arch) {
+        case Arch::X86_64:
+            archName = "x86_64";
+            toolchain.emulation = "elf_x86_64";
+            toolchain.dynamicLinker = musl ? "/lib/ld-musl-x86_64.so.1" : "/lib64/ld-linux-x86-64.so.2";
+            multiarch = musl ? "x86_64-linux-musl" : "x86_64-linux-gnu";
+            break;
+        case Arch::AArch64:
+            archName = "aarch64";
+            toolchain.emulation = "aarch64linux";
+            toolchain.dynamicLinker = musl ? "/lib/ld-musl-aarch64.so.1" : "/lib/ld-linux-aarch64.so.1";
+            multiarch = musl ? "aarch64-linux-musl" : "aarch64-linux-gnu";
+            break;
+        case Arch::RISCV64:
+            archName = "riscv64";
+            toolchain.emulation = "elf64lriscv";
+            toolchain.dynamicLinker = musl ? "/lib/ld-musl-riscv64.so.1" : "/lib/ld-linux-riscv64-lp64d.so.1";
+            multiarch = musl ? "riscv64-linux-musl" : "riscv64-linux-gnu";
+            break;
+        default:
+            // 32-bit ARM has too many float ABI variants to guess the loader
+            return std::nullopt;
+    }
+    if (!llvm::sys::fs::exists(toolchain.dynamicLinker)) {
+        return std::nullopt;
+    }
+
+    for (std::string directory : {"/usr/lib/" + multiarch, "/lib/" + multiarch, std::string("/usr/lib64"),
+                                  std::string("/usr/lib")}) {
+        if (hasFile(directory, "crt1.o") && hasFile(directory, "crti.o") && hasFile(directory, "crtn.o")) {
+            toolchain.crtDirectory = directory;
+            break;
+        }
+    }
+    toolchain.gccDirectory = findGCCDirectory(archName);
+    if (toolchain.crtDirectory.empty() || toolchain.gccDirectory.empty()) {
+        return std::nullopt;
+    }
+    return toolchain;
+}
+
+// Resolved once per target; a driver that links many times (jam --server)
+// doesn't search the file system again
+const std::optional<ELFToolchain>& getToolchain(const Target& target) {
+    static std::mutex mutex;
+    static std::map<std::string, std::optional<ELFToolchain>> toolchains;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string triple = target.toLLVMTriple();
+    auto found = toolchains.find(triple);
+    if (found == toolchains.end()) {
+        found = toolchains.emplace(triple, findToolchain(target)).first;
+    }
+    return found->second;
+}
+
+// Inputs lld takes as they are; anything else (a C source) needs clang
+bool isLinkerInput(llvm::StringRef input) {
+    return input.starts_with("-l") || input.starts_with("-L") || input.ends_with(".o") || input.ends_with(".a") ||
+           input.ends_with(".so") || input.contains(".so.");
+}
+
+} // namespace
+
+bool linkExecutable(const LinkJob& job, const Target& target, std::ostream& err, bool verbose) {
+    TimeScope timing("Link", job.output);
+
+    // lld keeps global state while linking and isn't safe to reenter. After
+    // a link that leaves it unable to run again, later links use clang.
+    static std::mutex lldMutex;
+    static bool lldUsable = true;
+
+    const char* reason = nullptr;
+    if (job.optimization.lto != LTOMode::None) {
+        reason = "LTO";
+    } else if (job.profileRuntime) {
+        reason = "profile runtime";
+    } else if (!std::all_of(job.inputs.begin(), job.inputs.end(),
+                            [](const std::string& input) { return isLinkerInput(input); })) {
+        reason = "C sources";
+    } else if (!getToolchain(target)) {
+        reason = "no C runtime found";
+    }
+
+    std::unique_lock<std::mutex> lock(lldMutex);
+    if (!reason && lldUsable) {
+        const ELFToolchain& toolchain = *getToolchain(target);
+        std::vector<std::string> args = {
+            "ld.lld", "--eh-frame-hdr", "-m", toolchain.emulation, "-dynamic-linker",
+            toolchain.dynamicLinker, "-o", job.output,
+            joinPath(toolchain.crtDirectory, "crt1.o"), joinPath(toolchain.crtDirectory, "crti.o"),
+            joinPath(toolchain.gccDirectory, "crtbegin.o"),
+            "-L" + toolchain.gccDirectory, "-L" + toolchain.crtDirectory,
+        };
+        args.insert(args.end(), job.objects.begin(), job.objects.end());
+        args.insert(args.end(), job.inputs.begin(), job.inputs.end());
+        for (const char* tail : {"-lgcc", "--as-needed", "-lgcc_s", "--no-as-needed", "-lc", "-lgcc", "--as-needed",
+                                 "-lgcc_s", "--no-as-needed"}) {
+            args.push_back(tail);
+        }
+        args.push_back(joinPath(toolchain.gccDirectory, "crtend.o"));
+        args.push_back(joinPath(toolchain.crtDirectory, "crtn.o"));
+
+        std::vector<const char*> argv;
+        for (const auto& arg : args) {
+            argv.push_back(arg.c_str());
+        }
+        std::string diagnostics;
+        llvm::raw_string_ostream diagnosticStream(diagnostics);
+        lld::Result result = lld::lldMain(argv, diagnosticStream, diagnosticStream, {{lld::Gnu, &lld::elf::link}});
+        lldUsable = result.canRunAgain;
+        err << diagnosticStream.str();
+        if (verbose) {
+            err << "[link] lld (in-process): " << job.output << std::endl;
+        }
+        return result.retCode == 0;
+    }
+    lock.unlock();
+
+    if (verbose) {
+        err << "[link] clang (" << (reason ? reason : "lld can't run again") << "): " << job.output << std::endl;
+    }
+    return system(getClangLinkCommand(job).c_str()) == 0;
+}
+
+bool hasInProcessLinker() {
+    return true;
+}
+#else
+bool linkExecutable(const LinkJob& job, const Target&, std::ostream& err, bool verbose) {
+    TimeScope timing("Link", job.output);
+    if (verbose) {
+        err << "[link] clang: " << job.output << std::endl;
+    }
+    return system(getClangLinkCommand(job).c_str()) == 0;
+}
+
+bool hasInProcessLinker() {
+    return false;
+}
+#endif
+
+} // namespace jam
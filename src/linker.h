@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef LINKER_H
+#define LINKER_H
+
+#include "optimizer.h"
+#include "target.h"
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace jam {
+
+// Everything that goes into one executable
+struct LinkJob {
+    std::vector<std::string> objects;  // objects (or LTO bitcode) jam produced
+    std::vector<std::string> inputs;   // user inputs: C sources, objects, archives, -l/-L flags
+    std::string output;
+    CPUModel cpu;
+    OptimizationOptions optimization;  // lto and level matter for LTO links
+    bool profileRuntime = false;       // link the -fprofile-generate runtime
+};
+
+// The clang command that links the job; also identifies the link in
+// jam build's link stamps
+std::string getClangLinkCommand(const LinkJob& job);
+
+// Link an executable.
+//
+// When jam is built with lld (liblld-dev), plain Linux links run the lld
+// ELF driver inside this process, which saves spawning the clang driver
+// and its linker on every build. The C runtime objects, the libc and the
+// dynamic loader are located from the target triple and getLibCName():
+// crt1/crti/crtn next to libc, crtbegin/crtend and libgcc from the newest
+// GCC installation for the target. Jobs lld alone can't finish fall back to
+// clang: C sources to compile, LTO, the profile runtime, non-ELF targets
+// or a runtime file that can't be found. `verbose` reports which linker
+// ran. Diagnostics go to err; returns whether the link succeeded.
+bool linkExecutable(const LinkJob& job, const Target& target, std::ostream& err, bool verbose = false);
+
+// Whether jam was built with lld, so linkExecutable can link in-process
+bool hasInProcessLinker();
+
+} // namespace jam
+
+#endif // LINKER_H
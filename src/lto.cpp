@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "lto.h"
+#include "llvm/Analysis/ModuleSummaryAnalysis.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/ModuleSummaryIndex.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include <stdexcept>
+
+namespace jam {
+
+LTOMode parseLTOMode(const std::string& value) {
+    if (value == "full") {
+        return LTOMode::Full;
+    } else if (value == "thin") {
+        return LTOMode::Thin;
+    }
+    throw std::runtime_error("Unknown LTO mode: " + value + " (expected full or thin)");
+}
+
+const char* getLTOModeName(LTOMode mode) {
+    switch (mode) {
+        case LTOMode::Full: return "full";
+        case LTOMode::Thin: return "thin";
+        case LTOMode::None: break;
+    }
+    return "none";
+}
+
+// The linker's code generator only sees per-function attributes
+static void recordCPUAttributes(llvm::Module& module, const CPUModel& cpu) {
+    for (auto& func : module) {
+        if (func.isDeclaration()) {
+            continue;
+        }
+        if (!func.hasFnAttribute("target-cpu")) {
+            func.addFnAttr("target-cpu", cpu.name);
+        }
+        if (cpu.features.empty()) {
+            continue;
+        }
+        // Keep per-clone features from @target_clones on top of the global ones
+        std::string features = cpu.features;
+        if (func.hasFnAttribute("target-features")) {
+            std::string existing = func.getFnAttribute("target-features").getValueAsString().str();
+            if (!existing.empty()) {
+                features += "," + existing;
+            }
+        }
+        func.addFnAttr("target-features", features);
+    }
+}
+
+void writeLTOBitcode(llvm::Module& module, const CPUModel& cpu, LTOMode mode, const std::string& filename) {
+    recordCPUAttributes(module, cpu);
+
+    std::error_code EC;
+    llvm::raw_fd_ostream out(filename, EC, llvm::sys::fs::OF_None);
+    if (EC) {
+        throw std::runtime_error("Could not open file: " + EC.message());
+    }
+
+    if (mode == LTOMode::Thin) {
+        llvm::ModuleSummaryIndex index = llvm::buildModuleSummaryIndex(module, nullptr, nullptr);
+        llvm::WriteBitcodeToFile(module, out, /*ShouldPreserveUseListOrder=*/false, &index);
+    } else {
+        llvm::WriteBitcodeToFile(module, out);
+    }
+}
+
+} // namespace jam
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef LTO_H
+#define LTO_H
+
+#include "target.h"
+#include "llvm/IR/Module.h"
+#include <string>
+
+namespace jam {
+
+// Link-time optimization mode (--lto=full|thin)
+enum class LTOMode {
+    None,
+    Full,  // One merged module optimized and code-generated at link time
+    Thin,  // Per-module summaries; cross-module import and backends run in parallel
+};
+
+// Parse "full" / "thin"; throws on anything else
+LTOMode parseLTOMode(const std::string& value);
+
+// Name used in clang's -flto=<mode>
+const char* getLTOModeName(LTOMode mode);
+
+// Write the module as LTO bitcode. Code generation happens in the linker,
+// so the selected CPU and features are recorded on every function first.
+// ThinLTO bitcode carries a module summary index for cross-module importing.
+void writeLTOBitcode(llvm::Module& module, const CPUModel& cpu, LTOMode mode, const std::string& filename);
+
+} // namespace jam
+
+#endif // LTO_H
@@ -11,36 +11,246 @@
 #include <string>
 #include <memory>
 #include <map>
+#include <vector>
+#include <set>
+#include <functional>
 
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/TargetSelect.h"
-#include "llvm/TargetParser/Host.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Support/FileSystem.h"
-#include "llvm/MC/TargetRegistry.h"
-#include "llvm/Target/TargetOptions.h"
+#include "llvm/Support/Path.h"
 #include "llvm/IR/LegacyPassManager.h"
-#include "llvm/ExecutionEngine/ExecutionEngine.h"
-#include "llvm/ExecutionEngine/GenericValue.h"
-#include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/CodeGen/ParallelCG.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 
 #include "lexer.h"
 #include "parser.h"
 #include "ast.h"
 #include "target.h"
+#include "build.h"
 #include "cabi.h"
+#include "codegen.h"
+#include "layout.h"
+#include "multiversion.h"
+#include "optimizer.h"
+#include "lto.h"
+#include "cimport.h"
+#include "jit.h"
+#include "jitcache.h"
+#include "linker.h"
+#include "pipeline.h"
+#include "hotreload.h"
+#include "interpreter.h"
+#include "repl.h"
+#include "server.h"
+#include "tiered.h"
+#include "timing.h"
+
+static void printUsage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [options] <filename> [link inputs...]" << std::endl;
+    std::cerr << "       " << argv0 << " repl [options]" << std::endl;
+    std::cerr << "       " << argv0 << " build [options] <modules.jam...> [link inputs...]" << std::endl;
+    std::cerr << "       " << argv0 << " --server[=<socket>] [options]" << std::endl;
+    std::cerr << "Options:" << std::endl;
+    std::cerr << "  --run                 Execute the program with the JIT" << std::endl;
+    std::cerr << "  --no-cache            Don't use the on-disk object cache of --run and build" << std::endl;
+    std::cerr << "  --cache-dir=<dir>     Object cache directory (default: ~/.cache/jam); may be shared between hosts" << std::endl;
+    std::cerr << "  -j <n>                With --run, compile on <n> threads and speculatively compile callees;" << std::endl;
+    std::cerr << "                        with build, compile <n> modules at once (default: one per core)" << std::endl;
+    std::cerr << "  -o <file>             Output file (default: output, or the input name with --emit); '-' is stdout" << std::endl;
+    std::cerr << "  --emit=<kinds>        Comma-separated outputs: exe (default), obj, asm, llvm-ir, bc" << std::endl;
+    std::cerr << "  --use-server[=<socket>]" << std::endl;
+    std::cerr << "                        With build or a compile to an executable, build on a running" << std::endl;
+    std::cerr << "                        jam --server (default socket: $XDG_RUNTIME_DIR/jam.sock);" << std::endl;
+    std::cerr << "                        builds locally if none is listening" << std::endl;
+    std::cerr << "  --interp              Run main with the bytecode interpreter (no LLVM code generation)" << std::endl;
+    std::cerr << "  --hot-reload          With --run, recompile functions when the source file changes" << std::endl;
+    std::cerr << "  --tiered              With --run, start at -O0 and re-optimize hot functions in the background" << std::endl;
+    std::cerr << "  --tier-threshold=<n>  Calls plus loop iterations before a function tiers up (default: 1000)" << std::endl;
+    std::cerr << "  --codegen-threads=<n> Split the module and emit the executable's machine code on n threads" << std::endl;
+    std::cerr << "  --time-report         Print the time spent in each phase and the slowest functions" << std::endl;
+    std::cerr << "  --time-trace=<file>   Write a Chrome trace of the compile (chrome://tracing, Perfetto)" << std::endl;
+    std::cerr << "  --time-trace-granularity=<us>  Leave out trace entries shorter than this (default: 500)" << std::endl;
+    std::cerr << "  --stream              Compile a huge program in bounded memory, stages on -j threads" << std::endl;
+    std::cerr << "  --verbose             Report cache hits and misses, tier-ups, and the linker used" << std::endl;
+    std::cerr << "  --target-info         Print target, CPU and feature information" << std::endl;
+    std::cerr << "  --print-layouts       Print struct sizes, padding and cache-line boundaries" << std::endl;
+    std::cerr << "  --cpu=<name>          Generate code for a specific CPU (default: generic)" << std::endl;
+    std::cerr << "  --features=<list>     Enable/disable CPU features, e.g. +avx2,-avx512f" << std::endl;
+    std::cerr << "  -march=<cpu|native>   Select a CPU; 'native' uses the host CPU and features" << std::endl;
+    std::cerr << "  -O0, -O1, -O2, -O3    Optimization level (default: -O0)" << std::endl;
+    std::cerr << "  --profile-generate[=<file>]" << std::endl;
+    std::cerr << "                        Instrument for PGO; the program writes <file> (default.profraw)" << std::endl;
+    std::cerr << "  --profile-use=<file>  Optimize with a merged .profdata profile (implies -O2)" << std::endl;
+    std::cerr << "  -I<dir>               Search <dir> for @cImport headers" << std::endl;
+    std::cerr << "  --lto=<full|thin>     Link-time optimization with C inputs (.c, .o, .bc; implies -O2)" << std::endl;
+}
+
+// File extension of each --emit kind; exe is the linked program
+static const std::map<std::string, std::string> EmitExtensions = {
+    {"exe", ""}, {"obj", ".o"}, {"asm", ".s"}, {"llvm-ir", ".ll"}, {"bc", ".bc"},
+};
+
+// Write an object or assembly file ("-" is stdout)
+static bool emitMachineCode(llvm::Module& module, llvm::TargetMachine* targetMachine, llvm::CodeGenFileType type,
+                            const std::string& path) {
+    jam::TimeScope timing("Emit", path);
+    std::error_code EC;
+    llvm::raw_fd_ostream dest(path, EC, type == llvm::CodeGenFileType::AssemblyFile ? llvm::sys::fs::OF_Text
+                                                                                     : llvm::sys::fs::OF_None);
+    if (EC) {
+        std::cerr << "Could not open file: " << EC.message() << std::endl;
+        return false;
+    }
+    llvm::legacy::PassManager pass;
+    if (targetMachine->addPassesToEmitFile(pass, dest, nullptr, type)) {
+        std::cerr << "TargetMachine can't emit a file of this type" << std::endl;
+        return false;
+    }
+    pass.run(module);
+    return true;
+}
+
+// Emit one object per partition of the module, the partitions generated in
+// parallel. SplitModule assigns functions to partitions by a hash of their
+// names, so the same module always gives the same objects. Locals are not
+// kept with their users, which would put all of main's call graph in one
+// partition; like LTO, it makes them hidden globals so any partition can
+// call them. They are renamed first with a suffix C can't spell, so they
+// don't clash with the symbols of C link inputs.
+static bool emitPartitionedObjects(llvm::Module& module,
+                                   const std::function<std::unique_ptr<llvm::TargetMachine>()>& makeTargetMachine,
+                                   const std::vector<std::string>& paths, bool verbose) {
+    jam::TimeScope timing("Emit", paths.front());
+    std::vector<std::unique_ptr<llvm::raw_fd_ostream>> streams;
+    std::vector<llvm::raw_pwrite_stream*> outputs;
+    for (const auto& path : paths) {
+        std::error_code EC;
+        streams.push_back(std::make_unique<llvm::raw_fd_ostream>(path, EC, llvm::sys::fs::OF_None));
+        if (EC) {
+            std::cerr << "Could not open file: " << EC.message() << std::endl;
+            return false;
+        }
+        outputs.push_back(streams.back().get());
+    }
+    for (llvm::GlobalValue& value : module.global_values()) {
+        if (value.hasLocalLinkage() && value.hasName()) {
+            value.setName(value.getName() + ".jam");
+        }
+    }
+    llvm::splitCodeGen(module, outputs, {}, makeTargetMachine, llvm::CodeGenFileType::ObjectFile,
+                       /*PreserveLocals=*/false);
+
+    bool written = true;
+    for (size_t i = 0; i < streams.size(); i++) {
+        streams[i]->close();
+        if (streams[i]->has_error()) {
+            std::cerr << "Could not write " << paths[i] << ": " << streams[i]->error().message() << std::endl;
+            streams[i]->clear_error();
+            written = false;
+        }
+    }
+    if (!written || !verbose) {
+        return written;
+    }
+
+    // How evenly the work was spread: functions defined in each partition
+    for (size_t i = 0; i < paths.size(); i++) {
+        unsigned functions = 0;
+        auto object = llvm::object::ObjectFile::createObjectFile(paths[i]);
+        if (!object) {
+            llvm::consumeError(object.takeError());
+            continue;
+        }
+        for (const llvm::object::SymbolRef& symbol : object->getBinary()->symbols()) {
+            auto type = symbol.getType();
+            auto flags = symbol.getFlags();
+            if (type && flags && *type == llvm::object::SymbolRef::ST_Function &&
+                !(*flags & llvm::object::SymbolRef::SF_Undefined)) {
+                functions++;
+            }
+            if (!type) {
+                llvm::consumeError(type.takeError());
+            }
+            if (!flags) {
+                llvm::consumeError(flags.takeError());
+            }
+        }
+        std::cerr << "[codegen-threads] partition " << i << ": " << functions << " functions" << std::endl;
+    }
+    return true;
+}
+
+// A unique file in the temp directory, so compiles sharing a directory
+// never write over each other's intermediates
+static std::string createTemporary(const char* extension) {
+    llvm::SmallString<256> path;
+    if (llvm::sys::fs::createTemporaryFile("jam", extension, path)) {
+        throw std::runtime_error("Could not create a temporary file");
+    }
+    return std::string(path);
+}
+
+// Call the JIT'd main through a native function pointer of its real type
+// (returnBits == 0 for void)
+static uint64_t callMain(void* address, unsigned returnBits) {
+    if (returnBits == 0) {
+        reinterpret_cast<void (*)()>(address)();
+        return 0;
+    }
+    switch (returnBits) {
+        case 1: return reinterpret_cast<bool (*)()>(address)();
+        case 8: return reinterpret_cast<uint8_t (*)()>(address)();
+        case 16: return reinterpret_cast<uint16_t (*)()>(address)();
+        case 32: return reinterpret_cast<uint32_t (*)()>(address)();
+        default: return reinterpret_cast<uint64_t (*)()>(address)();
+    }
+}
 
 int main(int argc, char* argv[]) {
     // Parse command line arguments
     bool runFlag = false;
+    bool replMode = false;
+    bool buildMode = false;
+    bool serverMode = false;
+    bool useServer = false;
+    std::string serverSocket = jam::getDefaultServerSocket();
+    bool interpMode = false;
+    bool useCache = true;
+    std::string cacheDir = jam::JITCache::getDefaultDirectory();
+    bool verbose = false;
+    bool tiered = false;
+    bool hotReload = false;
+    unsigned tierThreshold = jam::TieredJIT::DefaultThreshold;
+    unsigned compileThreads = 0;
+    unsigned codegenThreads = 1;
+    bool streamMode = false;
+    bool timeReport = false;
+    std::string timeTraceFile;
+    unsigned timeTraceGranularity = 500;
     bool showTarget = false;
+    bool printLayouts = false;
+    std::string cpuName;
+    std::string cpuFeatures;
+    jam::OptimizationOptions optOptions;
+    bool optLevelGiven = false;
     std::string filename;
+    std::string outputFile;
+    std::set<std::string> emitKinds = {"exe"};
+    bool emitGiven = false;
+    std::vector<std::string> linkInputs;
+    jam::BuildOptions buildOptions;
+    std::vector<std::string> includeDirs;
     
     if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " [--run] [--target-info] <filename>" << std::endl;
+        printUsage(argv[0]);
         return 1;
     }
     
@@ -50,45 +260,376 @@ int main(int argc, char* argv[]) {
         std::string arg = argv[i];
         if (arg == "--run") {
             runFlag = true;
+        } else if (arg == "--no-cache") {
+            useCache = false;
+        } else if (arg.rfind("--cache-dir=", 0) == 0) {
+            cacheDir = arg.substr(12);
+        } else if (arg == "--interp") {
+            interpMode = true;
+        } else if (arg == "--hot-reload") {
+            hotReload = true;
+        } else if (arg == "--tiered") {
+            tiered = true;
+        } else if (arg.rfind("--tier-threshold=", 0) == 0) {
+            try {
+                tierThreshold = static_cast<unsigned>(std::stoul(arg.substr(17)));
+            } catch (const std::exception&) {
+                std::cerr << "Error: invalid --tier-threshold: " << arg.substr(17) << std::endl;
+                return 1;
+            }
+            if (tierThreshold == 0) {
+                std::cerr << "Error: --tier-threshold must be at least 1" << std::endl;
+                return 1;
+            }
+        } else if (arg == "-j" || (arg.rfind("-j", 0) == 0 && arg.size() > 2)) {
+            std::string count = arg.size() > 2 ? arg.substr(2) : (i + 1 < argc ? argv[++i] : "");
+            try {
+                compileThreads = static_cast<unsigned>(std::stoul(count));
+            } catch (const std::exception&) {
+                std::cerr << "Error: invalid -j: " << count << std::endl;
+                return 1;
+            }
+        } else if (arg == "-o") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: -o needs a file name" << std::endl;
+                return 1;
+            }
+            outputFile = argv[++i];
+        } else if (arg == "--server" || arg.rfind("--server=", 0) == 0) {
+            serverMode = true;
+            if (arg.size() > 8) {
+                serverSocket = arg.substr(9);
+            }
+        } else if (arg == "--use-server" || arg.rfind("--use-server=", 0) == 0) {
+            useServer = true;
+            if (arg.size() > 12) {
+                serverSocket = arg.substr(13);
+            }
+        } else if (arg.rfind("--emit=", 0) == 0) {
+            emitKinds.clear();
+            emitGiven = true;
+            llvm::SmallVector<llvm::StringRef, 4> kinds;
+            llvm::StringRef(arg).substr(7).split(kinds, ',');
+            for (llvm::StringRef kind : kinds) {
+                if (!EmitExtensions.count(kind.str())) {
+                    std::cerr << "Error: unknown --emit kind '" << kind.str()
+                              << "'; expected exe, obj, asm, llvm-ir or bc" << std::endl;
+                    return 1;
+                }
+                emitKinds.insert(kind.str());
+            }
+        } else if (arg.rfind("--codegen-threads=", 0) == 0) {
+            try {
+                codegenThreads = static_cast<unsigned>(std::stoul(arg.substr(18)));
+            } catch (const std::exception&) {
+                std::cerr << "Error: invalid --codegen-threads: " << arg.substr(18) << std::endl;
+                return 1;
+            }
+            if (codegenThreads == 0) {
+                std::cerr << "Error: --codegen-threads must be at least 1" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--time-report") {
+            timeReport = true;
+        } else if (arg.rfind("--time-trace=", 0) == 0) {
+            timeTraceFile = arg.substr(13);
+        } else if (arg.rfind("--time-trace-granularity=", 0) == 0) {
+            // Unsigned parsing rejects a sign, which std::stoul would wrap
+            if (llvm::StringRef(arg).substr(25).getAsInteger(10, timeTraceGranularity)) {
+                std::cerr << "Error: invalid --time-trace-granularity: " << arg.substr(25) << std::endl;
+                return 1;
+            }
+        } else if (arg == "--stream") {
+            streamMode = true;
+        } else if (arg == "--verbose") {
+            verbose = true;
         } else if (arg == "--target-info") {
             showTarget = true;
-        } else {
+        } else if (arg == "--print-layouts") {
+            printLayouts = true;
+        } else if (arg.rfind("--cpu=", 0) == 0) {
+            cpuName = arg.substr(6);
+        } else if (arg.rfind("--features=", 0) == 0) {
+            cpuFeatures = arg.substr(11);
+        } else if (arg.rfind("-march=", 0) == 0) {
+            cpuName = arg.substr(7);
+        } else if (arg == "-O0" || arg == "-O1" || arg == "-O2" || arg == "-O3") {
+            optOptions.level = static_cast<jam::OptLevel>(arg[2] - '0');
+            optLevelGiven = true;
+        } else if (arg == "--profile-generate" || arg.rfind("--profile-generate=", 0) == 0) {
+            optOptions.pgo = jam::PGOMode::Generate;
+            optOptions.profileFile = arg.size() > 18 ? arg.substr(19) : "";
+        } else if (arg.rfind("--profile-use=", 0) == 0) {
+            optOptions.pgo = jam::PGOMode::Use;
+            optOptions.profileFile = arg.substr(14);
+        } else if (arg.rfind("--lto=", 0) == 0) {
+            try {
+                optOptions.lto = jam::parseLTOMode(arg.substr(6));
+            } catch (const std::exception& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                return 1;
+            }
+        } else if (arg.rfind("-I", 0) == 0 && arg.size() > 2) {
+            includeDirs.push_back(arg.substr(2));
+        } else if (filename.empty() && !replMode && arg == "repl") {
+            replMode = true;
+        } else if (filename.empty() && !replMode && !buildMode && arg == "build") {
+            buildMode = true;
+        } else if (buildMode) {
+            // Modules, then the C sources, objects and archives linked with them
+            if (llvm::sys::path::extension(arg) == ".jam") {
+                buildOptions.modules.push_back(arg);
+            } else {
+                buildOptions.linkInputs.push_back(arg);
+            }
+        } else if (filename.empty()) {
             filename = arg;
-            break;
+        } else {
+            // C sources, objects, bitcode and archives linked into the program
+            linkInputs.push_back(arg);
         }
     }
     
-    if (filename.empty()) {
+    if (buildMode && buildOptions.modules.empty()) {
+        std::cerr << "Error: jam build needs at least one .jam module" << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (serverMode && (buildMode || replMode || !filename.empty())) {
+        std::cerr << "Error: --server takes no input files; send it builds with jam build --use-server" << std::endl;
+        return 1;
+    }
+    if (useServer && !buildMode) {
+        // A compile to an executable is a build of one module, which the
+        // server can run with its warm state
+        if (filename.empty() || runFlag || interpMode || replMode || streamMode || emitGiven || printLayouts ||
+            codegenThreads > 1 || !includeDirs.empty() || optOptions.pgo != jam::PGOMode::None) {
+            std::cerr << "Error: --use-server applies to jam build and to compiling one file to an executable, "
+                         "without --emit, --stream, --codegen-threads, -I or PGO" << std::endl;
+            return 1;
+        }
+        buildMode = true;
+        buildOptions.modules.push_back(filename);
+        buildOptions.linkInputs = linkInputs;
+    }
+    if (filename.empty() && !replMode && !buildMode && !serverMode) {
         std::cerr << "Error: No input file specified" << std::endl;
-        std::cerr << "Usage: " << argv[0] << " [--run] [--target-info] <filename>" << std::endl;
+        printUsage(argv[0]);
         return 1;
     }
+
+    // Resolve the CPU model used by both the AOT and JIT paths
+    jam::CPUModel cpu;
+    if (cpuName == "native") {
+        cpu = jam::CPUModel::getHostCPU();
+    } else if (!cpuName.empty()) {
+        cpu.name = cpuName;
+    }
+    cpu.addFeatures(cpuFeatures);
+
+    // A profile or LTO is only worth applying to an optimized build
+    if ((optOptions.pgo == jam::PGOMode::Use || optOptions.lto != jam::LTOMode::None) && !optLevelGiven) {
+        optOptions.level = jam::OptLevel::O2;
+    }
+    if (optOptions.pgo == jam::PGOMode::Generate && runFlag) {
+        std::cerr << "Error: --profile-generate needs the profile runtime, which is only linked into AOT builds" << std::endl;
+        return 1;
+    }
+    if (interpMode && runFlag) {
+        std::cerr << "Error: --interp and --run are alternative ways to execute a program" << std::endl;
+        return 1;
+    }
+    if (tiered && !runFlag) {
+        std::cerr << "Error: --tiered only applies to --run" << std::endl;
+        return 1;
+    }
+    if (hotReload && (!runFlag || tiered || compileThreads > 0)) {
+        std::cerr << "Error: --hot-reload only applies to --run without --tiered or -j" << std::endl;
+        return 1;
+    }
+    if (streamMode && (buildMode || runFlag || interpMode || replMode || serverMode || emitGiven || printLayouts ||
+                       codegenThreads > 1 || optOptions.lto != jam::LTOMode::None ||
+                       optOptions.pgo != jam::PGOMode::None)) {
+        std::cerr << "Error: --stream only links executables; it does not combine with --run, --interp, "
+                     "jam build, --emit, --print-layouts, --codegen-threads, LTO or PGO" << std::endl;
+        return 1;
+    }
+    if (compileThreads > 0 && !buildMode && !streamMode && (!runFlag || tiered)) {
+        std::cerr << "Error: -j only applies to jam build, --stream and --run without --tiered" << std::endl;
+        return 1;
+    }
+    if (codegenThreads > 1 && (buildMode || runFlag || interpMode || replMode || serverMode)) {
+        std::cerr << "Error: --codegen-threads only applies to single-file compiles; jam build uses -j" << std::endl;
+        return 1;
+    }
+    // With LTO the linker generates the machine code, so there is nothing to split
+    if (codegenThreads > 1 && optOptions.lto != jam::LTOMode::None) {
+        std::cerr << "Error: --codegen-threads cannot be combined with --lto" << std::endl;
+        return 1;
+    }
+    if ((!outputFile.empty() || emitGiven) && (runFlag || interpMode || replMode || serverMode)) {
+        std::cerr << "Error: -o and --emit only apply to compiles" << std::endl;
+        return 1;
+    }
+    if (emitGiven && buildMode) {
+        std::cerr << "Error: jam build always links; --emit applies to single-file compiles" << std::endl;
+        return 1;
+    }
+    if (outputFile == "-" && (emitKinds.size() != 1 || emitKinds.count("exe"))) {
+        std::cerr << "Error: -o - needs exactly one --emit kind other than exe" << std::endl;
+        return 1;
+    }
+    if (!linkInputs.empty() && !runFlag && !emitKinds.count("exe")) {
+        std::cerr << "Error: link inputs are only used with --emit=exe" << std::endl;
+        return 1;
+    }
+    if (buildMode && (runFlag || interpMode || optOptions.pgo != jam::PGOMode::None)) {
+        std::cerr << "Error: jam build does not support --run, --interp or PGO" << std::endl;
+        return 1;
+    }
+    if (tiered && optOptions.pgo != jam::PGOMode::None) {
+        std::cerr << "Error: --tiered cannot be combined with PGO" << std::endl;
+        return 1;
+    }
+    // -O picks the level hot functions are re-optimized at
+    if (tiered && !optLevelGiven) {
+        optOptions.level = jam::OptLevel::O2;
+    }
+    if (runFlag && (optOptions.lto != jam::LTOMode::None || !linkInputs.empty())) {
+        std::cerr << "Error: --lto and link inputs only apply to AOT builds" << std::endl;
+        return 1;
+    }
+    bool timing = timeReport || !timeTraceFile.empty();
+    if (timing && (runFlag || interpMode || replMode || serverMode || useServer)) {
+        std::cerr << "Error: --time-report and --time-trace apply to compiles and local jam builds" << std::endl;
+        return 1;
+    }
+
+    // Report timings however the compile ends. A successful compile calls
+    // finish, so a trace that can't be written fails it.
+    struct TimingOutput {
+        bool active;
+        int finish(int status) {
+            if (!active) {
+                return status;
+            }
+            active = false;
+            bool written = jam::finishTiming(std::cerr);
+            return status == 0 && !written ? 1 : status;
+        }
+        ~TimingOutput() {
+            if (active) {
+                jam::finishTiming(std::cerr);
+            }
+        }
+    } timingOutput{timing};
+    if (timing) {
+        jam::startTiming(timeReport, timeTraceFile, timeTraceGranularity);
+    }
     
     // Get target information
     jam::Target target = jam::Target::getHostTarget();
     jam::CAbi cabi(target);
+    jam::LayoutEngine layouts(target, target.getCacheLineSize());
+    CurrentLayouts = &layouts;
+    CodegenTarget = &target;
+    CodegenCPU = &cpu;
     
     if (showTarget) {
         std::cout << "Target Information:" << std::endl;
         std::cout << "  Name: " << target.getName() << std::endl;
         std::cout << "  Triple: " << target.toLLVMTriple() << std::endl;
         std::cout << "  Pointer size: " << target.getPointerSize() << " bytes" << std::endl;
+        std::cout << "  Cache line: " << target.getCacheLineSize() << " bytes" << std::endl;
         std::cout << "  Libc: " << target.getLibCName() << std::endl;
         std::cout << "  Requires PIC: " << (target.requiresPIC() ? "yes" : "no") << std::endl;
         std::cout << "  Requires PIE: " << (target.requiresPIE() ? "yes" : "no") << std::endl;
         std::cout << "  Uses C ABI: " << (target.usesCabi() ? "yes" : "no") << std::endl;
+        std::cout << "  CPU: " << cpu.name << std::endl;
+        std::cout << "  Features: " << (cpu.features.empty() ? "(default)" : cpu.features) << std::endl;
+        std::cout << "  Linker: " << (jam::hasInProcessLinker() ? "lld (in-process)" : "clang") << std::endl;
         std::cout << std::endl;
     }
-    std::ifstream file(filename);
 
-    if (!file.is_open()) {
-        std::cerr << "Could not open file: " << filename << std::endl;
-        return 1;
+    if (replMode) {
+        llvm::InitializeNativeTarget();
+        llvm::InitializeNativeTargetAsmPrinter();
+        llvm::InitializeNativeTargetAsmParser();
+        return jam::runRepl(target, cpu, optOptions.level, std::cin, std::cout);
+    }
+
+    if (serverMode) {
+        llvm::InitializeNativeTarget();
+        llvm::InitializeNativeTargetAsmPrinter();
+        llvm::InitializeNativeTargetAsmParser();
+        return jam::runServer(serverSocket, target);
     }
 
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string source = buffer.str();
+    if (buildMode) {
+        buildOptions.cpu = cpu;
+        buildOptions.optimization = optOptions;
+        buildOptions.jobs = compileThreads;
+        buildOptions.useCache = useCache && !cacheDir.empty();
+        if (!cacheDir.empty()) {
+            llvm::SmallString<256> buildCacheDir(cacheDir);
+            llvm::sys::path::append(buildCacheDir, "build");
+            buildOptions.cacheDirectory = std::string(buildCacheDir);
+        }
+        buildOptions.verbose = verbose;
+        if (!outputFile.empty()) {
+            buildOptions.output = outputFile;
+        }
+
+        // The server does the work with LLVM and its caches already warm
+        int status;
+        if (useServer && jam::forwardBuild(serverSocket, buildOptions, status)) {
+            return status;
+        }
+        if (useServer) {
+            std::cerr << "Warning: no jam server on " << serverSocket << "; building locally" << std::endl;
+        }
+        llvm::InitializeNativeTarget();
+        llvm::InitializeNativeTargetAsmPrinter();
+        llvm::InitializeNativeTargetAsmParser();
+        return timingOutput.finish(jam::runBuild(target, buildOptions));
+    }
+
+    if (streamMode) {
+        jam::PipelineOptions pipelineOptions;
+        pipelineOptions.source = filename;
+        pipelineOptions.linkInputs = linkInputs;
+        if (!outputFile.empty()) {
+            pipelineOptions.output = outputFile;
+        }
+        pipelineOptions.jobs = compileThreads;
+        pipelineOptions.cpu = cpu;
+        pipelineOptions.optimization = optOptions;
+        pipelineOptions.verbose = verbose;
+        llvm::InitializeNativeTarget();
+        llvm::InitializeNativeTargetAsmPrinter();
+        llvm::InitializeNativeTargetAsmParser();
+        return timingOutput.finish(jam::runPipelinedCompile(target, pipelineOptions));
+    }
+
+    std::string source;
+    {
+        jam::TimeScope timing("Read", filename);
+        std::ifstream file(filename);
+
+        if (!file.is_open()) {
+            std::cerr << "Could not open file: " << filename << std::endl;
+            return 1;
+        }
+
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        source = buffer.str();
+    }
+
+    // The interpreter starts straight from the AST; LLVM is never initialized
+    if (interpMode) {
+        return jam::runInterpreter(source, layouts, std::cout);
+    }
 
     // Initialize LLVM
     llvm::InitializeNativeTarget();
@@ -96,11 +637,17 @@ int main(int argc, char* argv[]) {
     llvm::InitializeNativeTargetAsmParser();
 
     // Create a LLVM context and module
-    llvm::LLVMContext Context;
-    std::unique_ptr<llvm::Module> TheModule = std::make_unique<llvm::Module>("my cool compiler", Context);
+    // The context is heap-allocated so --run can hand it to the JIT with the module
+    auto Context = std::make_unique<llvm::LLVMContext>();
+    // Optimized compiles don't keep local value names unless the IR is wanted
+    Context->setDiscardValueNames(optOptions.level != jam::OptLevel::O0 && !emitKinds.count("llvm-ir"));
+    std::unique_ptr<llvm::Module> TheModule = std::make_unique<llvm::Module>("my cool compiler", *Context);
+
+    // Internal functions are keyed by source file in PGO profiles
+    TheModule->setSourceFileName(filename);
 
     // Create a builder for IR generation
-    llvm::IRBuilder<> Builder(Context);
+    llvm::IRBuilder<> Builder(*Context);
 
     // Tokenize the source code
     Lexer lexer(source);
@@ -113,95 +660,304 @@ int main(int argc, char* argv[]) {
     // Create a map to store variable values
     std::map<std::string, llvm::Value*> NamedValues;
 
+    // Imported modules are compiled separately and linked
+    if (!parser.getImports().empty()) {
+        std::cerr << "Error: " << filename << " imports other modules; compile it with jam build" << std::endl;
+        return 1;
+    }
+
+    // Reloaded modules are generated from the Jam source alone
+    if (hotReload && !parser.getCImports().empty()) {
+        std::cerr << "Error: @cImport is not supported with --hot-reload" << std::endl;
+        return 1;
+    }
+
+    // Translate @cImport headers; Jam declarations take precedence over C ones
+    jam::CImporter cimporter(target, includeDirs);
+    std::vector<std::unique_ptr<StructAST>> cStructs;
+    std::vector<std::unique_ptr<FunctionAST>> cFunctions;
+    try {
+        std::set<std::string> jamNames;
+        for (auto& structDecl : parser.getStructs()) {
+            jamNames.insert(structDecl->Name);
+        }
+        for (auto& function : functions) {
+            jamNames.insert(function->Name);
+        }
+
+        std::string sourceDir = llvm::sys::path::parent_path(filename).str();
+        for (const auto& header : parser.getCImports()) {
+            jam::CImportResult imported = cimporter.importHeader(cimporter.resolveHeader(header, sourceDir));
+            for (auto& structDecl : imported.structs) {
+                if (!jamNames.count(structDecl->Name)) {
+                    cStructs.push_back(std::move(structDecl));
+                }
+            }
+            for (auto& function : imported.functions) {
+                if (!jamNames.count(function->Name)) {
+                    cFunctions.push_back(std::move(function));
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // Lay out struct types before any function can refer to them
+    for (auto& structDecl : cStructs) {
+        structDecl->codegen(TheModule.get(), layouts);
+    }
+    for (auto& structDecl : parser.getStructs()) {
+        structDecl->codegen(TheModule.get(), layouts);
+    }
+
+    if (printLayouts) {
+        layouts.print(std::cout);
+        std::cout << std::endl;
+    }
+
     // Generate code from the AST
-    for (auto& function : functions) {
-        function->codegen(Builder, TheModule.get(), NamedValues);
+    try {
+        for (auto& function : cFunctions) {
+            function->codegen(Builder, TheModule.get(), NamedValues);
+        }
+        for (auto& function : functions) {
+            function->codegen(Builder, TheModule.get(), NamedValues);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // Bring in the static inline C functions the program calls
+    try {
+        cimporter.linkInlineFunctions(*TheModule);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // Expand @target_clones functions into per-ISA versions
+    try {
+        jam::lowerTargetClones(*TheModule, target, runFlag);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // Catch code generation bugs before LLVM acts on the module
+    {
+        jam::TimeScope timing("Verify", filename);
+        std::string verifyErrors;
+        llvm::raw_string_ostream verifyOut(verifyErrors);
+        if (llvm::verifyModule(*TheModule, &verifyOut)) {
+            std::cerr << "Error: generated invalid code: " << verifyOut.str() << std::endl;
+            return 1;
+        }
+    }
+
+    // Create the target machine shared by optimization and code generation
+    auto makeTargetMachine = [&]() { return jam::createTargetMachine(cpu, optOptions.level); };
+    llvm::TargetMachine* TargetMachine;
+    try {
+        TargetMachine = makeTargetMachine().release();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    TheModule->setTargetTriple(TargetMachine->getTargetTriple().str());
+    TheModule->setDataLayout(TargetMachine->createDataLayout());
+
+    // Run the optimization pipeline (including PGO instrumentation or profile use).
+    // Tiered and hot-reload runs start from unoptimized IR and optimize per
+    // function later.
+    if (!tiered && !hotReload) {
+        jam::optimizeModule(*TheModule, TargetMachine, optOptions);
     }
 
     if (runFlag) {
-        // Execute the code directly using LLVM JIT
+        // Execute the code with the ORC JIT; functions compile on first call
         std::cout << "Running Jam program..." << std::endl;
-        
-        // Create execution engine
-        std::string ErrStr;
-        llvm::ExecutionEngine* EE = llvm::EngineBuilder(std::move(TheModule))
-            .setErrorStr(&ErrStr)
-            .setEngineKind(llvm::EngineKind::JIT)
-            .create();
-        
-        if (!EE) {
-            std::cerr << "Failed to create execution engine: " << ErrStr << std::endl;
+
+        llvm::Function* MainFn = TheModule->getFunction("main");
+        if (!MainFn || MainFn->isDeclaration()) {
+            std::cerr << "Error: No main function found" << std::endl;
             return 1;
         }
-        
-        // Find the main function
-        llvm::Function* MainFn = EE->FindFunctionNamed("main");
-        if (!MainFn) {
-            std::cerr << "Error: No main function found" << std::endl;
-            delete EE;
+        // The JIT may free the module's context once it is compiled
+        llvm::Type* MainRetType = MainFn->getReturnType();
+        if (!MainRetType->isVoidTy() && !MainRetType->isIntegerTy()) {
+            std::cerr << "Error: main must return an integer or nothing" << std::endl;
+            return 1;
+        }
+        unsigned MainRetBits = MainRetType->isVoidTy() ? 0 : MainRetType->getIntegerBitWidth();
+
+        uint64_t ExitCode = 0;
+        try {
+            if (tiered) {
+                jam::TieredJIT jit(cpu, optOptions.level, tierThreshold, verbose);
+                jit.addModule(std::move(TheModule), std::move(Context));
+                ExitCode = callMain(jit.lookup("main"), MainRetBits);
+            } else if (hotReload) {
+                jam::HotReloadJIT jit(target, cpu, optOptions.level);
+                jit.addModule(std::move(TheModule), std::move(Context), source);
+                jit.watch(filename);
+                ExitCode = callMain(jit.lookup("main"), MainRetBits);
+            } else {
+                // Repeated runs of the same script link cached objects instead of running codegen
+                std::unique_ptr<jam::JITCache> cache;
+                if (useCache && !cacheDir.empty()) {
+                    cache = std::make_unique<jam::JITCache>(cacheDir, jam::JIT::getCacheSalt(cpu, optOptions.level),
+                                                            jam::JITCache::DefaultMaxBytes, verbose);
+                }
+
+                jam::JIT jit(cpu, optOptions.level, cache.get(), compileThreads);
+                jit.addModule(std::move(TheModule), std::move(Context));
+                ExitCode = callMain(jit.lookup("main"), MainRetBits);
+                if (cache && verbose) {
+                    std::cerr << "[jit-cache] " << cache->getHits() << " hits, " << cache->getMisses() << " misses" << std::endl;
+                }
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
             return 1;
         }
-        
-        // Execute the main function
-        std::vector<llvm::GenericValue> Args;
-        llvm::GenericValue Result = EE->runFunction(MainFn, Args);
-        
+
         // Print the result if main returns a value
-        if (!MainFn->getReturnType()->isVoidTy()) {
-            std::cout << std::endl << "Program exited with code: " << Result.IntVal.getZExtValue() << std::endl;
+        if (MainRetBits != 0) {
+            std::cout << std::endl << "Program exited with code: " << ExitCode << std::endl;
         } else {
             std::cout << std::endl << "Program completed successfully." << std::endl;
         }
-        
-        delete EE;
         return 0;
     } else {
-        // Print out the generated LLVM IR
-        std::string output;
-        llvm::raw_string_ostream out(output);
-        TheModule->print(out, nullptr);
-        std::cout << output;
+        // With several kinds, -o names them all, each with its own extension
+        auto outputPath = [&](const std::string& kind) {
+            if (!outputFile.empty() && emitKinds.size() == 1) {
+                return outputFile;
+            }
+            llvm::SmallString<256> base(!outputFile.empty() ? outputFile
+                                        : kind == "exe"     ? std::string("output")
+                                                            : llvm::sys::path::stem(filename).str());
+            if (!outputFile.empty()) {
+                llvm::sys::path::replace_extension(base, "");
+            }
+            return std::string(base) + EmitExtensions.at(kind);
+        };
 
-        // Now create the output binary
-        std::string TargetTriple = llvm::sys::getDefaultTargetTriple();
-        TheModule->setTargetTriple(TargetTriple);
+        // IR and bitcode first: code generation below rewrites the module
+        if (emitKinds.count("llvm-ir")) {
+            jam::TimeScope timing("Emit", outputPath("llvm-ir"));
+            std::error_code EC;
+            llvm::raw_fd_ostream out(outputPath("llvm-ir"), EC, llvm::sys::fs::OF_Text);
+            if (EC) {
+                std::cerr << "Could not open file: " << EC.message() << std::endl;
+                return 1;
+            }
+            TheModule->print(out, nullptr);
+        }
+        std::string BitcodeFilename;
+        if (emitKinds.count("bc")) {
+            BitcodeFilename = outputPath("bc");
+            jam::TimeScope timing("Emit", BitcodeFilename);
+            if (optOptions.lto != jam::LTOMode::None) {
+                try {
+                    jam::writeLTOBitcode(*TheModule, cpu, optOptions.lto, BitcodeFilename);
+                } catch (const std::exception& e) {
+                    std::cerr << e.what() << std::endl;
+                    return 1;
+                }
+            } else {
+                std::error_code EC;
+                llvm::raw_fd_ostream out(BitcodeFilename, EC, llvm::sys::fs::OF_None);
+                if (EC) {
+                    std::cerr << "Could not open file: " << EC.message() << std::endl;
+                    return 1;
+                }
+                llvm::WriteBitcodeToFile(*TheModule, out);
+            }
+        }
 
-        std::string Error;
-        const llvm::Target* Target = llvm::TargetRegistry::lookupTarget(TargetTriple, Error);
+        bool linking = emitKinds.count("exe") > 0;
+        bool needObject = emitKinds.count("obj") || (linking && optOptions.lto == jam::LTOMode::None);
+        if (emitKinds.count("asm")) {
+            std::unique_ptr<llvm::Module> copy = needObject ? llvm::CloneModule(*TheModule) : nullptr;
+            if (!emitMachineCode(copy ? *copy : *TheModule, TargetMachine, llvm::CodeGenFileType::AssemblyFile,
+                                 outputPath("asm"))) {
+                return 1;
+            }
+        }
 
-        if (!Target) {
-            std::cerr << "Failed to get target: " << Error << std::endl;
+        std::vector<std::string> temporaries;
+        std::vector<std::string> ObjectFilenames;
+        try {
+            if (needObject && emitKinds.count("obj")) {
+                // --emit=obj is one object, so it is generated on one thread
+                ObjectFilenames.push_back(outputPath("obj"));
+                if (!emitMachineCode(*TheModule, TargetMachine, llvm::CodeGenFileType::ObjectFile,
+                                     ObjectFilenames[0])) {
+                    return 1;
+                }
+            } else if (needObject) {
+                for (unsigned i = 0; i < codegenThreads; i++) {
+                    ObjectFilenames.push_back(createTemporary("o"));
+                    temporaries.push_back(ObjectFilenames.back());
+                }
+                bool emitted = codegenThreads > 1
+                                   ? emitPartitionedObjects(*TheModule, makeTargetMachine, ObjectFilenames, verbose)
+                                   : emitMachineCode(*TheModule, TargetMachine, llvm::CodeGenFileType::ObjectFile,
+                                                     ObjectFilenames[0]);
+                if (!emitted) {
+                    for (const auto& path : temporaries) {
+                        llvm::sys::fs::remove(path);
+                    }
+                    return 1;
+                }
+            }
+            if (linking && optOptions.lto != jam::LTOMode::None && BitcodeFilename.empty()) {
+                BitcodeFilename = createTemporary("bc");
+                temporaries.push_back(BitcodeFilename);
+                jam::TimeScope timing("Emit", BitcodeFilename);
+                jam::writeLTOBitcode(*TheModule, cpu, optOptions.lto, BitcodeFilename);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            for (const auto& path : temporaries) {
+                llvm::sys::fs::remove(path);
+            }
             return 1;
         }
+        if (!linking) {
+            if (timingOutput.finish(0) != 0) {
+                return 1;
+            }
+            if (outputFile != "-") {
+                std::cout << "Compilation completed successfully." << std::endl;
+            }
+            return 0;
+        }
 
-        llvm::TargetOptions opt;
-        auto RM = std::optional<llvm::Reloc::Model>();
-        auto TargetMachine = Target->createTargetMachine(TargetTriple, "generic", "", opt, RM);
-
-        TheModule->setDataLayout(TargetMachine->createDataLayout());
-
-        std::string ObjectFilename = "output.o";
-        std::error_code EC;
-        llvm::raw_fd_ostream dest(ObjectFilename, EC, llvm::sys::fs::OF_None);
-
-        if (EC) {
-            std::cerr << "Could not open file: " << EC.message() << std::endl;
+        jam::LinkJob link;
+        link.objects = optOptions.lto != jam::LTOMode::None ? std::vector<std::string>{BitcodeFilename} : ObjectFilenames;
+        link.inputs = linkInputs;
+        link.output = outputPath("exe");
+        link.cpu = cpu;
+        link.optimization = optOptions;
+        link.profileRuntime = optOptions.pgo == jam::PGOMode::Generate;
+        bool linked = jam::linkExecutable(link, target, std::cerr, verbose);
+        for (const auto& path : temporaries) {
+            llvm::sys::fs::remove(path);
+        }
+        if (!linked) {
+            std::cerr << "Error: linking failed" << std::endl;
             return 1;
         }
-
-        llvm::legacy::PassManager pass;
-        if (TargetMachine->addPassesToEmitFile(pass, dest, nullptr, llvm::CodeGenFileType::ObjectFile)) {
-            std::cerr << "TargetMachine can't emit a file of this type" << std::endl;
+        if (timingOutput.finish(0) != 0) {
             return 1;
         }
 
-        pass.run(*TheModule);
-        dest.close();
-
-        // Finish up by creating an executable using system compiler
-        std::string cmd = "clang " + ObjectFilename + " -o output";
-        system(cmd.c_str());
-
         std::cout << "Compilation completed successfully." << std::endl;
         return 0;
     }
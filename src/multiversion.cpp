@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "multiversion.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/GlobalIFunc.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/TargetParser/Host.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace jam {
+
+// x86 features usable in @target_clones, most capable first.
+// Bits index __cpu_model.__cpu_features[0] (libgcc / compiler-rt cpuinfo).
+struct CloneFeature {
+    const char* name;
+    unsigned bit;
+};
+
+static const CloneFeature X86CloneFeatures[] = {
+    {"avx512bw", 21},
+    {"avx512dq", 22},
+    {"avx512vl", 20},
+    {"avx512cd", 23},
+    {"avx512f", 15},
+    {"avx2", 10},
+    {"fma", 14},
+    {"bmi2", 17},
+    {"bmi", 16},
+    {"avx", 9},
+    {"aes", 18},
+    {"pclmul", 19},
+    {"sse4.2", 8},
+    {"popcnt", 2},
+    {"sse4.1", 7},
+    {"ssse3", 6},
+    {"sse3", 5},
+};
+
+static const CloneFeature* findCloneFeature(const std::string& name) {
+    for (const auto& feature : X86CloneFeatures) {
+        if (name == feature.name) {
+            return &feature;
+        }
+    }
+    return nullptr;
+}
+
+// Position in X86CloneFeatures doubles as dispatch priority
+static size_t getPriority(const CloneFeature* feature) {
+    return feature - X86CloneFeatures;
+}
+
+static void addTargetFeature(llvm::Function* func, const std::string& feature) {
+    std::string features = "+" + feature;
+    if (func->hasFnAttribute("target-features")) {
+        std::string existing = func->getFnAttribute("target-features").getValueAsString().str();
+        if (!existing.empty()) {
+            features = existing + "," + features;
+        }
+    }
+    func->addFnAttr("target-features", features);
+}
+
+void setTargetClones(llvm::Function* func, const std::vector<std::string>& clones) {
+    std::string value;
+    for (const auto& clone : clones) {
+        if (!value.empty()) value += ",";
+        value += clone;
+    }
+    func->addFnAttr(TargetClonesAttr, value);
+}
+
+// Resolver: runs before constructors, so it initializes the CPU model itself
+static llvm::Function* createResolver(llvm::Module& module, llvm::Function* func,
+                                      const std::vector<std::pair<const CloneFeature*, llvm::Function*>>& versions,
+                                      llvm::Function* defaultVersion) {
+    llvm::LLVMContext& context = module.getContext();
+    llvm::Type* i32Ty = llvm::Type::getInt32Ty(context);
+
+    llvm::FunctionCallee cpuInit = module.getOrInsertFunction(
+        "__cpu_indicator_init", llvm::FunctionType::get(llvm::Type::getVoidTy(context), false));
+
+    // struct __processor_model { u32 vendor, type, subtype; u32 features[1]; }
+    llvm::StructType* cpuModelTy = llvm::StructType::get(context, {i32Ty, i32Ty, i32Ty, llvm::ArrayType::get(i32Ty, 1)});
+    llvm::GlobalVariable* cpuModel = llvm::cast<llvm::GlobalVariable>(module.getOrInsertGlobal("__cpu_model", cpuModelTy));
+    cpuModel->setDSOLocal(true);
+
+    llvm::Function* resolver = llvm::Function::Create(
+        llvm::FunctionType::get(func->getType(), false),
+        llvm::Function::InternalLinkage,
+        func->getName() + ".resolver",
+        &module
+    );
+
+    llvm::IRBuilder<> builder(llvm::BasicBlock::Create(context, "entry", resolver));
+    builder.CreateCall(cpuInit);
+    llvm::Value* featuresPtr = builder.CreateInBoundsGEP(cpuModelTy, cpuModel,
+        {builder.getInt32(0), builder.getInt32(3), builder.getInt32(0)});
+    llvm::Value* features = builder.CreateLoad(i32Ty, featuresPtr, "cpu_features");
+
+    for (const auto& [feature, clone] : versions) {
+        llvm::Value* mask = llvm::ConstantInt::get(i32Ty, 1u << feature->bit);
+        llvm::Value* hasFeature = builder.CreateICmpNE(builder.CreateAnd(features, mask), llvm::ConstantInt::get(i32Ty, 0), "has_" + std::string(feature->name));
+
+        llvm::BasicBlock* selectBB = llvm::BasicBlock::Create(context, std::string("select_") + feature->name, resolver);
+        llvm::BasicBlock* nextBB = llvm::BasicBlock::Create(context, "next", resolver);
+        builder.CreateCondBr(hasFeature, selectBB, nextBB);
+
+        builder.SetInsertPoint(selectBB);
+        builder.CreateRet(clone);
+        builder.SetInsertPoint(nextBB);
+    }
+    builder.CreateRet(defaultVersion);
+
+    return resolver;
+}
+
+void lowerTargetClones(llvm::Module& module, const Target& target, bool forJIT) {
+    std::vector<llvm::Function*> worklist;
+    for (auto& func : module) {
+        if (func.hasFnAttribute(TargetClonesAttr)) {
+            worklist.push_back(&func);
+        }
+    }
+
+    for (llvm::Function* func : worklist) {
+        std::string name = func->getName().str();
+        std::string list = func->getFnAttribute(TargetClonesAttr).getValueAsString().str();
+        func->removeFnAttr(TargetClonesAttr);
+
+        if (func->isDeclaration()) {
+            throw std::runtime_error("@target_clones requires a function body: " + name);
+        }
+
+        // Parse and order the requested clones, most capable first
+        std::vector<const CloneFeature*> features;
+        bool hasDefault = false;
+        std::stringstream ss(list);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            if (item == "default") {
+                hasDefault = true;
+            } else if (const CloneFeature* feature = findCloneFeature(item)) {
+                features.push_back(feature);
+            } else {
+                throw std::runtime_error("Unknown @target_clones feature \"" + item + "\" on " + name);
+            }
+        }
+        if (!hasDefault) {
+            throw std::runtime_error("@target_clones on " + name + " must include \"default\"");
+        }
+        std::sort(features.begin(), features.end(), [](const CloneFeature* a, const CloneFeature* b) {
+            return getPriority(a) < getPriority(b);
+        });
+
+        if (target.arch != Arch::X86_64) {
+            std::cerr << "Warning: @target_clones is only supported on x86_64; using the default version of " << name << std::endl;
+            continue;
+        }
+
+        if (forJIT) {
+            // The JIT compiles for the machine it runs on: pick the best clone directly
+            llvm::StringMap<bool> hostFeatures;
+            llvm::sys::getHostCPUFeatures(hostFeatures);
+            for (const CloneFeature* feature : features) {
+                if (hostFeatures.lookup(feature->name)) {
+                    addTargetFeature(func, feature->name);
+                    break;
+                }
+            }
+            continue;
+        }
+
+        if (target.os != OS::Linux && target.os != OS::FreeBSD) {
+            std::cerr << "Warning: ifunc dispatch is not available on " << target.getName() << "; using the default version of " << name << std::endl;
+            continue;
+        }
+
+        // One clone per ISA, plus the untouched default
+        std::vector<std::pair<const CloneFeature*, llvm::Function*>> versions;
+        for (const CloneFeature* feature : features) {
+            llvm::ValueToValueMapTy vmap;
+            llvm::Function* clone = llvm::CloneFunction(func, vmap);
+            clone->setName(name + "." + feature->name);
+            clone->setLinkage(llvm::Function::InternalLinkage);
+            addTargetFeature(clone, feature->name);
+            versions.emplace_back(feature, clone);
+        }
+
+        llvm::ValueToValueMapTy vmap;
+        llvm::Function* defaultVersion = llvm::CloneFunction(func, vmap);
+        defaultVersion->setName(name + ".default");
+        defaultVersion->setLinkage(llvm::Function::InternalLinkage);
+
+        llvm::Function* resolver = createResolver(module, func, versions, defaultVersion);
+
+        // Callers (and C, for exported functions) now go through the ifunc
+        llvm::GlobalIFunc* ifunc = llvm::GlobalIFunc::create(
+            func->getFunctionType(),
+            func->getAddressSpace(),
+            func->getLinkage(),
+            "",
+            resolver,
+            &module
+        );
+        ifunc->takeName(func);
+        func->replaceAllUsesWith(ifunc);
+        func->eraseFromParent();
+    }
+}
+
+} // namespace jam
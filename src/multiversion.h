@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef MULTIVERSION_H
+#define MULTIVERSION_H
+
+#include "target.h"
+#include "llvm/IR/Module.h"
+#include <string>
+#include <vector>
+
+namespace jam {
+
+// Function attribute carrying the @target_clones list from codegen to lowering
+constexpr const char* TargetClonesAttr = "jam-target-clones";
+
+// Mark a function for multiversioning, e.g. {"avx2", "avx512f", "default"}
+void setTargetClones(llvm::Function* func, const std::vector<std::string>& clones);
+
+// Lower every @target_clones function in the module.
+//
+// AOT (forJIT = false): emit one clone per ISA (f.avx2, f.avx512f, f.default)
+// plus an ifunc whose resolver picks the best clone at load time from the
+// CPUID bits that libgcc/compiler-rt exposes through __cpu_model.
+//
+// JIT (forJIT = true): the code runs on the host, so the best clone the host
+// supports is chosen directly and no resolver is emitted.
+void lowerTargetClones(llvm::Module& module, const Target& target, bool forJIT);
+
+} // namespace jam
+
+#endif // MULTIVERSION_H
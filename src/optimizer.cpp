@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "optimizer.h"
+#include "timing.h"
+#include "llvm/Analysis/CGSCCPassManager.h"
+#include "llvm/Analysis/LoopAnalysisManager.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/StandardInstrumentations.h"
+#include "llvm/Support/PGOOptions.h"
+#include "llvm/Support/VirtualFileSystem.h"
+#include "llvm/Target/TargetOptions.h"
+#include "llvm/TargetParser/Host.h"
+#include "llvm/Transforms/IPO/HotColdSplitting.h"
+#include <optional>
+#include <stdexcept>
+
+namespace jam {
+
+llvm::CodeGenOptLevel toCodeGenOptLevel(OptLevel level) {
+    switch (level) {
+        case OptLevel::O0: return llvm::CodeGenOptLevel::None;
+        case OptLevel::O1: return llvm::CodeGenOptLevel::Less;
+        case OptLevel::O2: return llvm::CodeGenOptLevel::Default;
+        case OptLevel::O3: return llvm::CodeGenOptLevel::Aggressive;
+    }
+    return llvm::CodeGenOptLevel::Default;
+}
+
+std::unique_ptr<llvm::TargetMachine> createTargetMachine(const CPUModel& cpu, OptLevel level) {
+    std::string triple = llvm::sys::getDefaultTargetTriple();
+    std::string error;
+    const llvm::Target* target = llvm::TargetRegistry::lookupTarget(triple, error);
+    if (!target) {
+        throw std::runtime_error("Failed to get target: " + error);
+    }
+    llvm::TargetOptions targetOptions;
+    return std::unique_ptr<llvm::TargetMachine>(target->createTargetMachine(
+        triple, cpu.name, cpu.features, targetOptions, std::optional<llvm::Reloc::Model>(), std::nullopt,
+        toCodeGenOptLevel(level)));
+}
+
+static llvm::OptimizationLevel toOptimizationLevel(OptLevel level) {
+    switch (level) {
+        case OptLevel::O0: return llvm::OptimizationLevel::O0;
+        case OptLevel::O1: return llvm::OptimizationLevel::O1;
+        case OptLevel::O2: return llvm::OptimizationLevel::O2;
+        case OptLevel::O3: return llvm::OptimizationLevel::O3;
+    }
+    return llvm::OptimizationLevel::O2;
+}
+
+void optimizeModule(llvm::Module& module, llvm::TargetMachine* targetMachine, const OptimizationOptions& options) {
+    // Nothing to do for a plain -O0 build
+    if (options.level == OptLevel::O0 && options.pgo == PGOMode::None && options.lto == LTOMode::None) {
+        return;
+    }
+    TimeScope timing("Optimize", module.getModuleIdentifier());
+
+    std::optional<llvm::PGOOptions> pgoOptions;
+    if (options.pgo == PGOMode::Generate) {
+        pgoOptions = llvm::PGOOptions(options.profileFile, "", "", "", llvm::vfs::getRealFileSystem(), llvm::PGOOptions::IRInstr);
+    } else if (options.pgo == PGOMode::Use) {
+        pgoOptions = llvm::PGOOptions(options.profileFile, "", "", "", llvm::vfs::getRealFileSystem(), llvm::PGOOptions::IRUse);
+    }
+
+    llvm::LoopAnalysisManager LAM;
+    llvm::FunctionAnalysisManager FAM;
+    llvm::CGSCCAnalysisManager CGAM;
+    llvm::ModuleAnalysisManager MAM;
+
+    // With --time-trace, every pass gets its own entry in the trace
+    llvm::PassInstrumentationCallbacks PIC;
+    llvm::TimeProfilingPassesHandler timeProfiling;
+    if (llvm::timeTraceProfilerEnabled()) {
+        timeProfiling.registerCallbacks(PIC);
+    }
+
+    llvm::PassBuilder PB(targetMachine, llvm::PipelineTuningOptions(), pgoOptions, &PIC);
+
+    // With a profile, move cold blocks out of hot functions
+    if (options.pgo == PGOMode::Use && options.level != OptLevel::O0) {
+        PB.registerOptimizerLastEPCallback([](llvm::ModulePassManager& MPM, llvm::OptimizationLevel) {
+            MPM.addPass(llvm::HotColdSplittingPass());
+        });
+    }
+
+    PB.registerModuleAnalyses(MAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+    llvm::ModulePassManager MPM;
+    if (options.level == OptLevel::O0) {
+        MPM = PB.buildO0DefaultPipeline(llvm::OptimizationLevel::O0, options.lto != LTOMode::None);
+    } else if (options.lto == LTOMode::Thin) {
+        MPM = PB.buildThinLTOPreLinkDefaultPipeline(toOptimizationLevel(options.level));
+    } else if (options.lto == LTOMode::Full) {
+        MPM = PB.buildLTOPreLinkDefaultPipeline(toOptimizationLevel(options.level));
+    } else {
+        MPM = PB.buildPerModuleDefaultPipeline(toOptimizationLevel(options.level));
+    }
+    MPM.run(module, MAM);
+}
+
+} // namespace jam
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "lto.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Target/TargetMachine.h"
+#include <memory>
+#include <string>
+
+namespace jam {
+
+// Optimization level (-O0 .. -O3)
+enum class OptLevel {
+    O0,
+    O1,
+    O2,
+    O3,
+};
+
+// Profile-guided optimization mode
+enum class PGOMode {
+    None,
+    Generate,  // --profile-generate: insert counters, write a .profraw at exit
+    Use,       // --profile-use=file.profdata: feed branch weights and hotness
+};
+
+struct OptimizationOptions {
+    OptLevel level = OptLevel::O0;
+    PGOMode pgo = PGOMode::None;
+    std::string profileFile;  // .profraw output (Generate) or .profdata input (Use)
+    LTOMode lto = LTOMode::None;
+};
+
+// Map to the backend optimization level used when creating a TargetMachine
+llvm::CodeGenOptLevel toCodeGenOptLevel(OptLevel level);
+
+// TargetMachine for the default triple, used for ahead-of-time compiles.
+// One TargetMachine can't emit on several threads at once, so each thread
+// creates its own. Throws std::runtime_error if the target isn't registered.
+std::unique_ptr<llvm::TargetMachine> createTargetMachine(const CPUModel& cpu, OptLevel level);
+
+// Run the new pass manager pipeline for the given level.
+// With PGOMode::Generate the IR is instrumented (PGOInstrumentationGen);
+// with PGOMode::Use the profile drives branch weights, inlining, function
+// hotness (.text.hot / .text.unlikely placement) and hot/cold splitting.
+// With LTO only the pre-link pipeline runs; the rest happens in the linker.
+void optimizeModule(llvm::Module& module, llvm::TargetMachine* targetMachine, const OptimizationOptions& options);
+
+} // namespace jam
+
+#endif // OPTIMIZER_H
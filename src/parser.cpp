@@ -6,6 +6,7 @@
  */
 
 #include "parser.h"
+#include "timing.h"
 #include <stdexcept>
 
 Parser::Parser(std::vector<Token> tokens) : tokens(std::move(tokens)) {}
@@ -58,6 +59,22 @@ std::unique_ptr<ExprAST> Parser::parsePrimary() {
         return std::make_unique<BooleanExprAST>(false);
     } else if (match(TOK_STRING_LITERAL)) {
         return std::make_unique<StringLiteralExprAST>(previous().lexeme);
+    } else if (match(TOK_TRY)) {
+        return std::make_unique<TryExprAST>(parsePrimary());
+    } else if (match(TOK_AT)) {
+        // Builtin namespace, e.g. @target.cache_line
+        consume(TOK_IDENTIFIER, "Expected builtin name after '@'");
+        if (previous().lexeme != "target") {
+            throw std::runtime_error("Unknown builtin: @" + previous().lexeme);
+        }
+        consume(TOK_DOT, "Expected '.' after @target");
+        consume(TOK_IDENTIFIER, "Expected target constant name after '@target.'");
+        return std::make_unique<TargetConstantExprAST>(previous().lexeme);
+    } else if (match(TOK_ERROR)) {
+        consume(TOK_OPEN_PAREN, "Expected '(' after 'error'");
+        auto code = parseComparison();
+        consume(TOK_CLOSE_PAREN, "Expected ')' after error code");
+        return std::make_unique<ErrorExprAST>(std::move(code));
     } else if (match(TOK_OPEN_PAREN)) {
         auto expr = parseExpression();
         consume(TOK_CLOSE_PAREN, "Expected ')' after expression");
@@ -80,6 +97,17 @@ std::unique_ptr<ExprAST> Parser::parsePrimary() {
             return std::make_unique<CallExprAST>(name, std::move(args));
         }
 
+        if (match(TOK_DOT)) {
+            // Struct field access, possibly nested
+            std::vector<std::string> fields;
+            do {
+                consume(TOK_IDENTIFIER, "Expected field name after '.'");
+                fields.push_back(previous().lexeme);
+            } while (match(TOK_DOT));
+
+            return std::make_unique<FieldAccessExprAST>(name, std::move(fields));
+        }
+
         return std::make_unique<VariableExprAST>(name);
     }
 
@@ -87,12 +115,18 @@ std::unique_ptr<ExprAST> Parser::parsePrimary() {
 }
 
 std::string Parser::parseType() {
-    if (match(TOK_OPEN_BRACKET)) {
+    if (match(TOK_BANG)) {
+        // Error union: !T
+        return "!" + parseType();
+    } else if (match(TOK_OPEN_BRACKET)) {
         consume(TOK_CLOSE_BRACKET, "Expected ']' after '['");
         std::string elementType = parseType();
         return "[]" + elementType;
     } else if (match(TOK_TYPE)) {
         return previous().lexeme;
+    } else if (match(TOK_IDENTIFIER)) {
+        // User-defined struct type
+        return previous().lexeme;
     } else {
         throw std::runtime_error("Expected type");
     }
@@ -179,6 +213,10 @@ std::unique_ptr<ExprAST> Parser::parseExpression() {
     } else if (match(TOK_CONTINUE)) {
         consume(TOK_SEMI, "Expected ';' after continue");
         return std::make_unique<ContinueExprAST>();
+    } else if (check(TOK_TRY)) {
+        auto expr = parseComparison();
+        consume(TOK_SEMI, "Expected ';' after try expression");
+        return expr;
     } else if (check(TOK_IDENTIFIER)) {
         // Look ahead to see if this is a function call statement
         int saved_current = current;
@@ -227,6 +265,11 @@ std::unique_ptr<ExprAST> Parser::parseComparison() {
 std::unique_ptr<ExprAST> Parser::parseAddition() {
     auto LHS = parsePrimary();
 
+    if (match(TOK_CATCH)) {
+        auto fallback = parsePrimary();
+        LHS = std::make_unique<CatchExprAST>(std::move(LHS), std::move(fallback));
+    }
+
     if (match(TOK_PLUS)) {
         auto RHS = parsePrimary();
         return std::make_unique<BinaryExprAST>("+", std::move(LHS), std::move(RHS));
@@ -236,6 +279,23 @@ std::unique_ptr<ExprAST> Parser::parseAddition() {
 }
 
 std::unique_ptr<FunctionAST> Parser::parseFunction() {
+    // Function attributes
+    std::vector<std::string> targetClones;
+    while (match(TOK_AT)) {
+        consume(TOK_IDENTIFIER, "Expected attribute name after '@'");
+        std::string attr = previous().lexeme;
+        if (attr == "target_clones") {
+            consume(TOK_OPEN_PAREN, "Expected '(' after @target_clones");
+            do {
+                consume(TOK_STRING_LITERAL, "Expected target name string in @target_clones");
+                targetClones.push_back(previous().lexeme);
+            } while (match(TOK_COMMA));
+            consume(TOK_CLOSE_PAREN, "Expected ')' after @target_clones targets");
+        } else {
+            throw std::runtime_error("Unknown function attribute: @" + attr);
+        }
+    }
+
     // Check for extern or export keywords
     bool isExtern = false;
     bool isExport = false;
@@ -275,6 +335,9 @@ std::unique_ptr<FunctionAST> Parser::parseFunction() {
 
     // Extern functions don't have a body
     if (isExtern) {
+        if (!targetClones.empty()) {
+            throw std::runtime_error("@target_clones requires a function body");
+        }
         consume(TOK_SEMI, "Expected ';' after extern function declaration");
         std::vector<std::unique_ptr<ExprAST>> emptyBody;
         return std::make_unique<FunctionAST>(name, std::move(args), returnType, std::move(emptyBody), true, false);
@@ -289,14 +352,96 @@ std::unique_ptr<FunctionAST> Parser::parseFunction() {
 
     consume(TOK_CLOSE_BRACE, "Expected '}' after function body");
 
-    return std::make_unique<FunctionAST>(name, std::move(args), returnType, std::move(body), false, isExport);
+    auto function = std::make_unique<FunctionAST>(name, std::move(args), returnType, std::move(body), false, isExport);
+    function->TargetClones = std::move(targetClones);
+    return function;
+}
+
+std::unique_ptr<StructAST> Parser::parseStruct() {
+    bool isExtern = match(TOK_EXTERN);
+
+    consume(TOK_STRUCT, "Expected 'struct' keyword");
+    consume(TOK_IDENTIFIER, "Expected struct name");
+    std::string name = previous().lexeme;
+
+    consume(TOK_OPEN_BRACE, "Expected '{' after struct name");
+
+    std::vector<jam::FieldDecl> fields;
+    while (!check(TOK_CLOSE_BRACE) && !isAtEnd()) {
+        jam::FieldDecl field;
+
+        // Optional @hot annotation
+        if (match(TOK_AT)) {
+            consume(TOK_IDENTIFIER, "Expected attribute name after '@'");
+            if (previous().lexeme != "hot") {
+                throw std::runtime_error("Unknown field attribute: @" + previous().lexeme);
+            }
+            field.isHot = true;
+        }
+
+        consume(TOK_IDENTIFIER, "Expected field name");
+        field.name = previous().lexeme;
+        consume(TOK_COLON, "Expected ':' after field name");
+        field.type = parseType();
+        fields.push_back(field);
+
+        if (!match(TOK_COMMA)) {
+            break;
+        }
+    }
+
+    consume(TOK_CLOSE_BRACE, "Expected '}' after struct fields");
+
+    return std::make_unique<StructAST>(name, std::move(fields), isExtern);
+}
+
+std::vector<std::unique_ptr<ExprAST>> Parser::parseStatements() {
+    std::vector<std::unique_ptr<ExprAST>> statements;
+
+    while (!isAtEnd()) {
+        if (check(TOK_RETURN) || check(TOK_CONST) || check(TOK_VAR) || check(TOK_IF) ||
+            check(TOK_WHILE) || check(TOK_FOR) || check(TOK_BREAK) || check(TOK_CONTINUE)) {
+            statements.push_back(parseExpression());
+        } else {
+            statements.push_back(parseComparison());
+            match(TOK_SEMI);
+        }
+    }
+
+    return statements;
+}
+
+void Parser::parseCImport() {
+    consume(TOK_AT, "Expected '@'");
+    consume(TOK_IDENTIFIER, "Expected 'cImport'");
+    consume(TOK_OPEN_PAREN, "Expected '(' after @cImport");
+    consume(TOK_STRING_LITERAL, "Expected header name string in @cImport");
+    cImports.push_back(previous().lexeme);
+    consume(TOK_CLOSE_PAREN, "Expected ')' after @cImport header");
+    consume(TOK_SEMI, "Expected ';' after @cImport");
+}
+
+void Parser::parseImport() {
+    consume(TOK_IMPORT, "Expected 'import'");
+    consume(TOK_STRING_LITERAL, "Expected module path string after import");
+    imports.push_back(previous().lexeme);
+    consume(TOK_SEMI, "Expected ';' after import");
 }
 
 std::vector<std::unique_ptr<FunctionAST>> Parser::parse() {
+    jam::TimeScope timing("Parse");
     std::vector<std::unique_ptr<FunctionAST>> functions;
 
     while (!isAtEnd()) {
-        functions.push_back(parseFunction());
+        if (check(TOK_AT) && tokens[current + 1].lexeme == "cImport") {
+            parseCImport();
+        } else if (check(TOK_IMPORT)) {
+            parseImport();
+        } else if (check(TOK_STRUCT) || (check(TOK_EXTERN) && tokens[current + 1].type == TOK_STRUCT)) {
+            structs.push_back(parseStruct());
+        } else {
+            functions.push_back(parseFunction());
+        }
     }
 
     return functions;
@@ -17,6 +17,9 @@ class Parser {
 private:
     std::vector<Token> tokens;
     int current = 0;
+    std::vector<std::unique_ptr<StructAST>> structs;
+    std::vector<std::string> cImports;
+    std::vector<std::string> imports;
 
     Token peek() const;
     Token previous() const;
@@ -32,10 +35,25 @@ private:
     std::unique_ptr<ExprAST> parseComparison();
     std::unique_ptr<ExprAST> parseAddition();
     std::unique_ptr<FunctionAST> parseFunction();
+    std::unique_ptr<StructAST> parseStruct();
+    void parseCImport();
+    void parseImport();
 
 public:
     explicit Parser(std::vector<Token> tokens);
     std::vector<std::unique_ptr<FunctionAST>> parse();
+
+    // REPL input: statements where a bare expression needs no trailing ';'
+    std::vector<std::unique_ptr<ExprAST>> parseStatements();
+
+    // Struct declarations collected by parse(), in source order
+    std::vector<std::unique_ptr<StructAST>>& getStructs() { return structs; }
+
+    // Headers named by @cImport("foo.h"), in source order
+    const std::vector<std::string>& getCImports() const { return cImports; }
+
+    // Modules named by import "net/parse.jam", in source order
+    const std::vector<std::string>& getImports() const { return imports; }
 };
 
 #endif // PARSER_H
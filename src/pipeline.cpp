@@ -0,0 +1,490 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "pipeline.h"
+#include "ast.h"
+#include "codegen.h"
+#include "layout.h"
+#include "lexer.h"
+#include "linker.h"
+#include "multiversion.h"
+#include "parser.h"
+#include "timing.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
+namespace jam {
+
+namespace {
+
+// A module is handed to the emit threads once it holds this many
+// instructions; smaller modules bound memory more tightly, larger ones give
+// the optimizer more to inline across
+constexpr unsigned ModuleInstructionLimit = 20000;
+
+// A queue between two stages. push blocks while it is full, so a fast
+// producer waits for its consumer instead of buffering the whole program.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity_(capacity) {}
+
+    // Returns false, dropping the item, once the queue is closed
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        notFull_.wait(lock, [&] { return closed_ || items_.size() < capacity_; });
+        if (closed_) {
+            return false;
+        }
+        items_.push_back(std::move(item));
+        notEmpty_.notify_one();
+        return true;
+    }
+
+    // Returns false once the queue is closed and empty
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        notEmpty_.wait(lock, [&] { return closed_ || !items_.empty(); });
+        if (items_.empty()) {
+            return false;
+        }
+        item = std::move(items_.front());
+        items_.pop_front();
+        notFull_.notify_one();
+        return true;
+    }
+
+    // No more items: consumers drain what is queued, producers stop
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        notEmpty_.notify_all();
+        notFull_.notify_all();
+    }
+
+private:
+    size_t capacity_;
+    std::deque<T> items_;
+    bool closed_ = false;
+    std::mutex mutex_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+};
+
+// One top-level declaration, as a slice of the mapped source
+struct SourceItem {
+    enum Kind { Function, Struct, Import, CImport };
+    Kind kind;
+    llvm::StringRef text;
+    unsigned line;  // where the declaration starts
+};
+
+bool startsWithWord(llvm::StringRef text, llvm::StringRef word) {
+    return text.substr(0, word.size()) == word &&
+           (text.size() == word.size() || !(std::isalnum(static_cast<unsigned char>(text[word.size()])) ||
+                                            text[word.size()] == '_'));
+}
+
+// Cuts the source into top-level declarations without lexing it: a
+// declaration ends at the '}' that closes its outermost brace, or at a ';'
+// outside braces (extern fn, import, @cImport). Comments and string
+// literals are skipped, so braces inside them don't count.
+class ItemScanner {
+public:
+    explicit ItemScanner(llvm::StringRef source) : source_(source) {}
+
+    bool next(SourceItem& item) {
+        skipSpace();
+        if (position_ >= source_.size()) {
+            return false;
+        }
+        size_t start = position_;
+        item.line = line_;
+        int depth = 0;
+        while (position_ < source_.size()) {
+            char c = source_[position_++];
+            if (c == '\n') {
+                line_++;
+            } else if (c == '/' && position_ < source_.size() && source_[position_] == '/') {
+                while (position_ < source_.size() && source_[position_] != '\n') {
+                    position_++;
+                }
+            } else if (c == '"') {
+                while (position_ < source_.size() && source_[position_] != '"') {
+                    line_ += source_[position_++] == '\n';
+                }
+                position_++;
+            } else if (c == '{') {
+                depth++;
+            } else if (c == '}' && --depth <= 0) {
+                break;
+            } else if (c == ';' && depth == 0) {
+                break;
+            }
+        }
+        item.text = source_.slice(start, std::min(position_, source_.size()));
+
+        llvm::StringRef rest = item.text;
+        if (startsWithWord(rest, "extern")) {
+            rest = rest.drop_front(6).ltrim();
+        }
+        if (startsWithWord(rest, "struct")) {
+            item.kind = SourceItem::Struct;
+        } else if (startsWithWord(item.text, "import")) {
+            item.kind = SourceItem::Import;
+        } else if (startsWithWord(item.text, "@cImport")) {
+            item.kind = SourceItem::CImport;
+        } else {
+            item.kind = SourceItem::Function;
+        }
+        return true;
+    }
+
+private:
+    llvm::StringRef source_;
+    size_t position_ = 0;
+    unsigned line_ = 1;
+
+    void skipSpace() {
+        while (position_ < source_.size()) {
+            char c = source_[position_];
+            if (c == '\n') {
+                line_++;
+                position_++;
+            } else if (c == ' ' || c == '\t' || c == '\r') {
+                position_++;
+            } else if (c == '/' && position_ + 1 < source_.size() && source_[position_ + 1] == '/') {
+                while (position_ < source_.size() && source_[position_] != '\n') {
+                    position_++;
+                }
+            } else {
+                return;
+            }
+        }
+    }
+};
+
+// Lex and parse one declaration; errors name the line it starts on
+Parser parseItem(const SourceItem& item, const std::string& path,
+                 std::vector<std::unique_ptr<FunctionAST>>& functions) {
+    try {
+        Lexer lexer(item.text.str());
+        Parser parser(lexer.scanTokens());
+        functions = parser.parse();
+        return parser;
+    } catch (const std::exception& e) {
+        throw std::runtime_error(path + ":" + std::to_string(item.line) + ": " + e.what());
+    }
+}
+
+// A module being generated, or waiting to be emitted
+struct PendingModule {
+    std::unique_ptr<llvm::LLVMContext> context;
+    std::unique_ptr<llvm::Module> module;
+    std::string objectPath;
+    unsigned functions = 0;
+};
+
+// The first error of any stage; the others stop at their next step
+class PipelineError {
+public:
+    void set(const std::string& message) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (message_.empty()) {
+            message_ = message;
+        }
+    }
+
+    std::string get() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return message_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::string message_;
+};
+
+// Later modules call a function through its prototype. A non-export
+// function can't stay internal for that, and its plain name may belong to a C
+// input, so it becomes a hidden symbol with the ".jam" suffix
+// emitPartitionedObjects uses, and the prototype declares that name
+void publishFunction(llvm::Function& generated, const FunctionAST& function,
+                     std::map<std::string, std::unique_ptr<FunctionAST>>& prototypes) {
+    if (generated.hasInternalLinkage()) {
+        generated.setName(generated.getName() + ".jam");
+        generated.setLinkage(llvm::GlobalValue::ExternalLinkage);
+        generated.setVisibility(llvm::GlobalValue::HiddenVisibility);
+    }
+    prototypes[function.Name] = std::make_unique<FunctionAST>(generated.getName().str(), function.Args,
+                                                              function.ReturnType,
+                                                              std::vector<std::unique_ptr<ExprAST>>(),
+                                                              /*isExtern=*/true);
+}
+
+void emitModule(PendingModule& pending, llvm::TargetMachine& targetMachine, const PipelineOptions& options) {
+    optimizeModule(*pending.module, &targetMachine, options.optimization);
+    TimeScope timing("Emit", pending.objectPath);
+
+    std::error_code EC;
+    llvm::raw_fd_ostream dest(pending.objectPath, EC, llvm::sys::fs::OF_None);
+    if (EC) {
+        throw std::runtime_error("Could not open file: " + EC.message());
+    }
+    llvm::legacy::PassManager pass;
+    if (targetMachine.addPassesToEmitFile(pass, dest, nullptr, llvm::CodeGenFileType::ObjectFile)) {
+        throw std::runtime_error("TargetMachine can't emit a file of this type");
+    }
+    pass.run(*pending.module);
+}
+
+} // namespace
+
+int runPipelinedCompile(const Target& target, const PipelineOptions& options) {
+    // Mapped, so untouched parts of a huge source don't count against memory
+    std::unique_ptr<llvm::MemoryBuffer> mapped;
+    {
+        TimeScope timing("Read", options.source);
+        auto buffer = llvm::MemoryBuffer::getFile(options.source, /*IsText=*/false, /*RequiresNullTerminator=*/false);
+        if (!buffer) {
+            std::cerr << "Could not open file: " << options.source << std::endl;
+            return 1;
+        }
+        mapped = std::move(*buffer);
+    }
+    llvm::StringRef source = mapped->getBuffer();
+
+    // Structs first: any function may use any of them
+    std::vector<std::unique_ptr<StructAST>> structs;
+    try {
+        ItemScanner scanner(source);
+        SourceItem item;
+        while (scanner.next(item)) {
+            if (item.kind == SourceItem::Import) {
+                throw std::runtime_error(options.source + " imports other modules; compile it with jam build");
+            }
+            if (item.kind == SourceItem::CImport) {
+                throw std::runtime_error("@cImport is not supported with --stream");
+            }
+            if (item.kind == SourceItem::Struct) {
+                std::vector<std::unique_ptr<FunctionAST>> none;
+                Parser parser = parseItem(item, options.source, none);
+                for (auto& structDecl : parser.getStructs()) {
+                    structs.push_back(std::move(structDecl));
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    unsigned emitThreads = options.jobs;
+    if (emitThreads == 0) {
+        // The parse thread and this one take the rest
+        unsigned hardware = std::thread::hardware_concurrency();
+        emitThreads = hardware > 2 ? hardware - 2 : 1;
+    }
+
+    PipelineError error;
+    BoundedQueue<std::unique_ptr<FunctionAST>> parsed(16);
+    BoundedQueue<std::unique_ptr<PendingModule>> generated(emitThreads);
+
+    // Stage 1: parse one function at a time
+    std::thread parseThread([&] {
+        startTimingThread();
+        try {
+            ItemScanner scanner(source);
+            SourceItem item;
+            bool stopped = false;
+            while (!stopped && scanner.next(item)) {
+                if (item.kind != SourceItem::Function) {
+                    continue;
+                }
+                std::vector<std::unique_ptr<FunctionAST>> functions;
+                parseItem(item, options.source, functions);
+                for (auto& function : functions) {
+                    // The queue closes early when another stage fails
+                    if (!parsed.push(std::move(function))) {
+                        stopped = true;
+                        break;
+                    }
+                }
+            }
+        } catch (const std::exception& e) {
+            error.set(e.what());
+        }
+        parsed.close();
+        finishTimingThread();
+    });
+
+    // Stage 3: optimize and emit finished modules
+    std::vector<std::thread> emitters;
+    for (unsigned i = 0; i < emitThreads; i++) {
+        emitters.emplace_back([&] {
+            startTimingThread();
+            try {
+                std::unique_ptr<llvm::TargetMachine> targetMachine = createTargetMachine(options.cpu, options.optimization.level);
+                std::unique_ptr<PendingModule> pending;
+                while (generated.pop(pending)) {
+                    emitModule(*pending, *targetMachine, options);
+                    if (options.verbose) {
+                        std::cerr << "[stream] emitted " << pending->functions << " functions to "
+                                  << pending->objectPath << std::endl;
+                    }
+                    // Free the IR and its context as soon as the object is written
+                    pending.reset();
+                }
+            } catch (const std::exception& e) {
+                error.set(e.what());
+                generated.close();
+                parsed.close();
+            }
+            finishTimingThread();
+        });
+    }
+
+    // Stage 2: generate code on this thread
+    std::vector<std::string> objects;
+    std::map<std::string, std::unique_ptr<FunctionAST>> prototypes;
+    CodegenTarget = &target;
+    CodegenCPU = &options.cpu;
+    CurrentPrototypes = &prototypes;
+    try {
+        std::unique_ptr<llvm::TargetMachine> targetMachine = createTargetMachine(options.cpu, options.optimization.level);
+        std::unique_ptr<PendingModule> current;
+        std::unique_ptr<LayoutEngine> layouts;
+        unsigned instructions = 0;
+
+        auto finishModule = [&] {
+            lowerTargetClones(*current->module, target, /*forJIT=*/false);
+            {
+                TimeScope timing("Verify");
+                std::string verifyErrors;
+                llvm::raw_string_ostream verifyOut(verifyErrors);
+                if (llvm::verifyModule(*current->module, &verifyOut)) {
+                    throw std::runtime_error("generated invalid code: " + verifyOut.str());
+                }
+            }
+            generated.push(std::move(current));
+            current.reset();
+            instructions = 0;
+        };
+
+        std::unique_ptr<FunctionAST> function;
+        while (parsed.pop(function)) {
+            if (!current) {
+                current = std::make_unique<PendingModule>();
+                current->context = std::make_unique<llvm::LLVMContext>();
+                current->context->setDiscardValueNames(options.optimization.level != OptLevel::O0);
+                current->module = std::make_unique<llvm::Module>(options.source, *current->context);
+                current->module->setSourceFileName(options.source);
+                current->module->setTargetTriple(targetMachine->getTargetTriple().str());
+                current->module->setDataLayout(targetMachine->createDataLayout());
+
+                llvm::SmallString<256> objectPath;
+                if (llvm::sys::fs::createTemporaryFile("jam", "o", objectPath)) {
+                    throw std::runtime_error("Could not create a temporary file");
+                }
+                current->objectPath = std::string(objectPath);
+                objects.push_back(current->objectPath);
+
+                // Every module has its own context, so its own struct types
+                layouts = std::make_unique<LayoutEngine>(target, target.getCacheLineSize());
+                CurrentLayouts = layouts.get();
+                for (auto& structDecl : structs) {
+                    structDecl->codegen(current->module.get(), *layouts);
+                }
+            }
+
+            llvm::IRBuilder<> builder(*current->context);
+            std::map<std::string, llvm::Value*> namedValues;
+            llvm::Function* generatedFunction;
+            try {
+                generatedFunction = function->codegen(builder, current->module.get(), namedValues);
+            } catch (const std::exception& e) {
+                throw std::runtime_error("in fn " + function->Name + ": " + e.what());
+            }
+            instructions += generatedFunction->getInstructionCount();
+            current->functions++;
+
+            // Only the prototype outlives code generation
+            publishFunction(*generatedFunction, *function, prototypes);
+            function.reset();
+
+            if (instructions >= ModuleInstructionLimit) {
+                finishModule();
+            }
+        }
+        if (current) {
+            finishModule();
+        }
+    } catch (const std::exception& e) {
+        error.set(e.what());
+        parsed.close();
+    }
+    generated.close();
+    CurrentPrototypes = nullptr;
+    CurrentLayouts = nullptr;
+
+    parseThread.join();
+    for (auto& emitter : emitters) {
+        emitter.join();
+    }
+
+    auto removeObjects = [&] {
+        for (const auto& path : objects) {
+            llvm::sys::fs::remove(path);
+        }
+    };
+    std::string message = error.get();
+    if (!message.empty()) {
+        std::cerr << "Error: " << message << std::endl;
+        removeObjects();
+        return 1;
+    }
+    if (options.verbose) {
+        std::cerr << "[stream] " << prototypes.size() << " functions in " << objects.size() << " modules"
+                  << std::endl;
+    }
+
+    LinkJob link;
+    link.objects = objects;
+    link.inputs = options.linkInputs;
+    link.output = options.output;
+    link.cpu = options.cpu;
+    link.optimization = options.optimization;
+    bool linked = linkExecutable(link, target, std::cerr, options.verbose);
+    removeObjects();
+    if (!linked) {
+        std::cerr << "Error: linking failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Compilation completed successfully." << std::endl;
+    return 0;
+}
+
+} // namespace jam
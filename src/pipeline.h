@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "optimizer.h"
+#include "target.h"
+#include <string>
+#include <vector>
+
+namespace jam {
+
+struct PipelineOptions {
+    std::string source;                   // the .jam file
+    std::vector<std::string> linkInputs;  // objects, archives and -l flags
+    std::string output = "output";
+    unsigned jobs = 0;                    // optimize/emit threads; 0: one per spare hardware thread
+    CPUModel cpu;
+    OptimizationOptions optimization;
+    bool verbose = false;                 // report each module as it is emitted
+};
+
+// jam --stream: compile a very large program in bounded memory.
+//
+// The source is mapped rather than read and is cut into top-level
+// declarations without lexing the whole file first. Struct declarations are
+// parsed up front, since any function may use them. Then three stages run at
+// once:
+//
+//   parse thread    lexes and parses one function at a time
+//   this thread     generates each function into the current module,
+//                   starting a new module (with its own LLVMContext) every
+//                   ModuleInstructionLimit instructions
+//   emit threads    optimize each finished module, write its object to a
+//                   temporary file and free it
+//
+// The stages are joined by queues holding at most a few functions or
+// modules, so only those, the source mapping and one prototype per function
+// are in memory at any time, however long the program is. A function's AST
+// is freed as soon as it is generated, its IR once its object is written.
+// The objects are then linked by linkExecutable.
+//
+// A call to a function of an earlier module is declared from its prototype
+// (CurrentPrototypes), so functions must still be declared before they are
+// called, as in any Jam program. Non-export functions get hidden external
+// linkage instead of internal linkage, so other modules can call them, and a
+// ".jam" suffix so they can't clash with C symbols; as a result the optimizer
+// inlines only within a module. @cImport, imports, LTO
+// and PGO are not supported. Returns the exit status.
+int runPipelinedCompile(const Target& target, const PipelineOptions& options);
+
+} // namespace jam
+
+#endif // PIPELINE_H
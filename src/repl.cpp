@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "repl.h"
+#include "ast.h"
+#include "codegen.h"
+#include "lexer.h"
+#include "parser.h"
+#include "session.h"
+#include "llvm/IR/IRBuilder.h"
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace jam {
+
+namespace {
+
+class ReplSession {
+public:
+    ReplSession(const Target& target, const CPUModel& cpu, OptLevel level) : session_(target, cpu, level) {}
+
+    void eval(const std::string& input);
+
+private:
+    Session session_;
+
+    void emitPrint(llvm::IRBuilder<>& builder, llvm::Module* module, llvm::Value* value);
+};
+
+void ReplSession::emitPrint(llvm::IRBuilder<>& builder, llvm::Module* module, llvm::Value* value) {
+    llvm::LLVMContext& ctx = module->getContext();
+    llvm::Type* i64Ty = llvm::Type::getInt64Ty(ctx);
+    llvm::FunctionCallee printfFunc = module->getOrInsertFunction(
+        "printf", llvm::FunctionType::get(llvm::Type::getInt32Ty(ctx), llvm::PointerType::get(llvm::Type::getInt8Ty(ctx), 0), true));
+
+    llvm::Type* type = value->getType();
+    if (type->isIntegerTy(1)) {
+        llvm::Value* text = builder.CreateSelect(value, builder.CreateGlobalStringPtr("true"), builder.CreateGlobalStringPtr("false"));
+        builder.CreateCall(printfFunc, {builder.CreateGlobalStringPtr("%s\n"), text});
+    } else if (type->isIntegerTy()) {
+        builder.CreateCall(printfFunc, {builder.CreateGlobalStringPtr("%llu\n"), builder.CreateZExt(value, i64Ty)});
+    } else if (isErrorUnionType(type) && llvm::cast<llvm::StructType>(type)->getElementType(0)->isIntegerTy()) {
+        // error(N) or the payload
+        llvm::Value* payload = builder.CreateZExt(builder.CreateExtractValue(value, 0), i64Ty);
+        llvm::Value* code = builder.CreateZExt(builder.CreateExtractValue(value, 1), i64Ty);
+        llvm::Value* isErr = builder.CreateICmpNE(code, llvm::ConstantInt::get(i64Ty, 0));
+        llvm::Value* format = builder.CreateSelect(isErr, builder.CreateGlobalStringPtr("error(%llu)\n"), builder.CreateGlobalStringPtr("%llu\n"));
+        builder.CreateCall(printfFunc, {format, builder.CreateSelect(isErr, code, payload)});
+    } else if (type == getTypeFromString("str", ctx)) {
+        llvm::Value* ptr = builder.CreateExtractValue(value, 0);
+        llvm::Value* len = builder.CreateTrunc(builder.CreateExtractValue(value, 1), llvm::Type::getInt32Ty(ctx));
+        builder.CreateCall(printfFunc, {builder.CreateGlobalStringPtr("\"%.*s\"\n"), len, ptr});
+    }
+}
+
+void ReplSession::eval(const std::string& input) {
+    Lexer lexer(input);
+    std::vector<Token> tokens = lexer.scanTokens();
+    if (tokens.empty() || tokens[0].type == TOK_EOF) {
+        return;
+    }
+
+    Parser parser(tokens);
+    TokenType first = tokens[0].type;
+    bool isDefinition = first == TOK_FN || first == TOK_EXPORT || first == TOK_EXTERN ||
+                        first == TOK_STRUCT || first == TOK_AT;
+
+    if (isDefinition) {
+        session_.addDefinitions(input);
+        return;
+    }
+
+    // Statements run inside a fresh void function that prints the final value
+    std::vector<std::unique_ptr<ExprAST>> statements = parser.parseStatements();
+    std::unique_ptr<llvm::Module> module = session_.createModule(tokens);
+    llvm::LLVMContext& ctx = session_.getContext();
+    std::string name = "__repl_expr." + module->getName().str();
+    std::map<std::string, llvm::Value*> namedValues;
+    llvm::IRBuilder<> builder(ctx);
+    llvm::Function* func = llvm::Function::Create(
+        llvm::FunctionType::get(llvm::Type::getVoidTy(ctx), false),
+        llvm::Function::ExternalLinkage, name, module.get());
+    builder.SetInsertPoint(llvm::BasicBlock::Create(ctx, "entry", func));
+
+    for (size_t i = 0; i < statements.size(); i++) {
+        ExprAST* statement = statements[i].get();
+        if (dynamic_cast<ReturnExprAST*>(statement)) {
+            throw std::runtime_error("return outside of a function");
+        }
+        llvm::Value* value = statement->codegen(builder, module.get(), namedValues);
+
+        // Statements produce placeholder values; only print real expressions
+        bool isStatement = dynamic_cast<VarDeclAST*>(statement) || dynamic_cast<IfExprAST*>(statement) ||
+                           dynamic_cast<WhileExprAST*>(statement) || dynamic_cast<ForExprAST*>(statement) ||
+                           dynamic_cast<BreakExprAST*>(statement) || dynamic_cast<ContinueExprAST*>(statement);
+        if (auto* call = dynamic_cast<CallExprAST*>(statement)) {
+            isStatement = call->isPrintCall();
+        }
+        if (i + 1 == statements.size() && value && !isStatement && !builder.GetInsertBlock()->getTerminator()) {
+            emitPrint(builder, module.get(), value);
+        }
+    }
+    if (!builder.GetInsertBlock()->getTerminator()) {
+        builder.CreateRetVoid();
+    }
+
+    session_.finishModule(std::move(module));
+    reinterpret_cast<void (*)()>(session_.lookup(name))();
+    std::cout.flush();
+}
+
+// True once every '{' and '(' in the buffered input is closed
+static bool isComplete(const std::string& input) {
+    int depth = 0;
+    bool inString = false;
+    for (size_t i = 0; i < input.size(); i++) {
+        char c = input[i];
+        if (inString) {
+            if (c == '\\') i++;
+            else if (c == '"') inString = false;
+        } else if (c == '"') {
+            inString = true;
+        } else if (c == '{' || c == '(') {
+            depth++;
+        } else if (c == '}' || c == ')') {
+            depth--;
+        }
+    }
+    return depth <= 0;
+}
+
+} // namespace
+
+int runRepl(const Target& target, const CPUModel& cpu, OptLevel level, std::istream& in, std::ostream& out) {
+    std::unique_ptr<ReplSession> session;
+    try {
+        session = std::make_unique<ReplSession>(target, cpu, level);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    out << "jam repl - enter definitions or expressions, :quit to exit" << std::endl;
+    std::string buffer;
+    std::string line;
+    while (true) {
+        out << (buffer.empty() ? "jam> " : "...> ") << std::flush;
+        if (!std::getline(in, line)) {
+            break;
+        }
+        if (buffer.empty() && (line == ":quit" || line == ":q")) {
+            break;
+        }
+
+        buffer += line + "\n";
+        if (!isComplete(buffer)) {
+            continue;
+        }
+
+        try {
+            session->eval(buffer);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+        }
+        buffer.clear();
+    }
+    out << std::endl;
+    return 0;
+}
+
+} // namespace jam
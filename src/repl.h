@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef REPL_H
+#define REPL_H
+
+#include "optimizer.h"
+#include "target.h"
+#include <istream>
+#include <ostream>
+
+namespace jam {
+
+// jam repl: an interactive session on one persistent JIT.
+//
+// Every input is lexed, parsed and code-generated into its own small module
+// and added to the JIT, so only the new code is compiled. Definitions (fn,
+// struct) stay callable from later inputs; any other input is evaluated as
+// statements and the value of a trailing expression is printed. A block is
+// read until its braces and parentheses balance. Returns the exit status.
+int runRepl(const Target& target, const CPUModel& cpu, OptLevel level, std::istream& in, std::ostream& out);
+
+} // namespace jam
+
+#endif // REPL_H
@@ -0,0 +1,334 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "server.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace jam {
+
+namespace {
+
+constexpr uint32_t ProtocolVersion = 1;
+
+// Length-prefixed fields of one request or response
+class Message {
+public:
+    Message() = default;
+    explicit Message(std::string bytes) : bytes_(std::move(bytes)) {}
+
+    void writeU32(uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            bytes_.push_back(static_cast<char>(value >> (8 * i)));
+        }
+    }
+
+    void writeString(const std::string& value) {
+        writeU32(static_cast<uint32_t>(value.size()));
+        bytes_ += value;
+    }
+
+    void writeStrings(const std::vector<std::string>& values) {
+        writeU32(static_cast<uint32_t>(values.size()));
+        for (const auto& value : values) {
+            writeString(value);
+        }
+    }
+
+    uint32_t readU32() {
+        if (bytes_.size() - position_ < 4) {
+            throw std::runtime_error("truncated message");
+        }
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) {
+            value |= static_cast<uint32_t>(static_cast<uint8_t>(bytes_[position_++])) << (8 * i);
+        }
+        return value;
+    }
+
+    std::string readString() {
+        uint32_t size = readU32();
+        if (bytes_.size() - position_ < size) {
+            throw std::runtime_error("truncated message");
+        }
+        std::string value = bytes_.substr(position_, size);
+        position_ += size;
+        return value;
+    }
+
+    std::vector<std::string> readStrings() {
+        std::vector<std::string> values(readU32());
+        for (auto& value : values) {
+            value = readString();
+        }
+        return values;
+    }
+
+    const std::string& bytes() const { return bytes_; }
+
+private:
+    std::string bytes_;
+    size_t position_ = 0;
+};
+
+bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool readAll(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t got = ::read(fd, data, size);
+        if (got <= 0) {
+            return false;
+        }
+        data += got;
+        size -= static_cast<size_t>(got);
+    }
+    return true;
+}
+
+bool sendMessage(int fd, const Message& message) {
+    Message frame;
+    frame.writeString(message.bytes());
+    return writeAll(fd, frame.bytes().data(), frame.bytes().size());
+}
+
+bool receiveMessage(int fd, Message& message) {
+    char header[4];
+    if (!readAll(fd, header, sizeof(header))) {
+        return false;
+    }
+    uint32_t size = Message(std::string(header, sizeof(header))).readU32();
+    std::string bytes(size, '\0');
+    if (!readAll(fd, bytes.data(), size)) {
+        return false;
+    }
+    message = Message(std::move(bytes));
+    return true;
+}
+
+sockaddr_un makeAddress(const std::string& socketPath) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("socket path too long: " + socketPath);
+    }
+    std::strcpy(address.sun_path, socketPath.c_str());
+    return address;
+}
+
+int connectTo(const std::string& socketPath) {
+    sockaddr_un address = makeAddress(socketPath);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void writeOptions(Message& message, const BuildOptions& options) {
+    message.writeStrings(options.modules);
+    message.writeStrings(options.linkInputs);
+    message.writeString(options.output);
+    message.writeString(options.objectDirectory);
+    message.writeU32(options.jobs);
+    message.writeString(options.cpu.name);
+    message.writeString(options.cpu.features);
+    message.writeU32(static_cast<uint32_t>(options.optimization.level));
+    message.writeU32(static_cast<uint32_t>(options.optimization.lto));
+    message.writeU32(options.useCache ? 1 : 0);
+    message.writeString(options.cacheDirectory);
+    message.writeU32(options.verbose ? 1 : 0);
+}
+
+BuildOptions readOptions(Message& message) {
+    BuildOptions options;
+    options.modules = message.readStrings();
+    options.linkInputs = message.readStrings();
+    options.output = message.readString();
+    options.objectDirectory = message.readString();
+    options.jobs = message.readU32();
+    options.cpu.name = message.readString();
+    options.cpu.features = message.readString();
+    options.optimization.level = static_cast<OptLevel>(message.readU32());
+    options.optimization.lto = static_cast<LTOMode>(message.readU32());
+    options.useCache = message.readU32() != 0;
+    options.cacheDirectory = message.readString();
+    options.verbose = message.readU32() != 0;
+    return options;
+}
+
+std::string makeAbsolute(const std::string& path) {
+    llvm::SmallString<256> absolute(path);
+    llvm::sys::fs::make_absolute(absolute);
+    return std::string(absolute);
+}
+
+} // namespace
+
+std::string getDefaultServerSocket() {
+    if (const char* runtimeDir = std::getenv("XDG_RUNTIME_DIR")) {
+        llvm::SmallString<256> path(runtimeDir);
+        llvm::sys::path::append(path, "jam.sock");
+        return std::string(path);
+    }
+    return "/tmp/jam-" + std::to_string(::getuid()) + ".sock";
+}
+
+int runServer(const std::string& socketPath, const Target& target) {
+    int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        std::cerr << "Error: could not create socket: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    sockaddr_un address;
+    try {
+        address = makeAddress(socketPath);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // Replace the socket of a server that is gone, but never a live one
+    int existing = connectTo(socketPath);
+    if (existing >= 0) {
+        ::close(existing);
+        std::cerr << "Error: a jam server is already listening on " << socketPath << std::endl;
+        return 1;
+    }
+    ::unlink(socketPath.c_str());
+
+    if (::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listener, 16) != 0) {
+        std::cerr << "Error: could not listen on " << socketPath << ": " << std::strerror(errno) << std::endl;
+        ::close(listener);
+        return 1;
+    }
+    std::cerr << "[server] listening on " << socketPath << std::endl;
+
+    // A client that goes away mid-reply must not take the server down
+    std::signal(SIGPIPE, SIG_IGN);
+
+    BuildSession session(target);
+    while (true) {
+        int client = ::accept(listener, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Error: accept failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        Message request;
+        Message response;
+        std::string output = "(malformed request)";
+        int status = 1;
+        try {
+            if (!receiveMessage(client, request) || request.readU32() != ProtocolVersion) {
+                throw std::runtime_error("client speaks another protocol version");
+            }
+            BuildOptions options = readOptions(request);
+            output = options.output;
+            std::ostringstream out;
+            std::ostringstream err;
+            status = session.build(options, out, err);
+            response.writeU32(static_cast<uint32_t>(status));
+            response.writeString(out.str());
+            response.writeString(err.str());
+        } catch (const std::exception& e) {
+            response.writeU32(1);
+            response.writeString("");
+            response.writeString(std::string("Error: ") + e.what() + "\n");
+        }
+        sendMessage(client, response);
+        ::close(client);
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        std::cerr << "[server] " << output << ": " << (status == 0 ? "ok" : "failed") << " in "
+                  << elapsed.count() / 1000.0 << " ms" << std::endl;
+    }
+    ::close(listener);
+    return 1;
+}
+
+bool forwardBuild(const std::string& socketPath, const BuildOptions& options, int& status) {
+    int fd;
+    try {
+        fd = connectTo(socketPath);
+    } catch (const std::exception&) {
+        return false;
+    }
+    if (fd < 0) {
+        return false;
+    }
+
+    BuildOptions request = options;
+    for (auto& module : request.modules) {
+        module = makeAbsolute(module);
+    }
+    for (auto& input : request.linkInputs) {
+        // Linker flags such as -lm pass through as they are
+        if (!input.empty() && input[0] != '-') {
+            input = makeAbsolute(input);
+        }
+    }
+    request.output = makeAbsolute(request.output);
+    request.objectDirectory = makeAbsolute(request.objectDirectory);
+    if (!request.cacheDirectory.empty()) {
+        request.cacheDirectory = makeAbsolute(request.cacheDirectory);
+    }
+
+    Message message;
+    message.writeU32(ProtocolVersion);
+    writeOptions(message, request);
+    Message response;
+    bool ok = sendMessage(fd, message) && receiveMessage(fd, response);
+    ::close(fd);
+    if (!ok) {
+        std::cerr << "Error: lost connection to the jam server" << std::endl;
+        status = 1;
+        return true;
+    }
+
+    try {
+        status = static_cast<int>(response.readU32());
+        std::cout << response.readString();
+        std::cerr << response.readString();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: bad response from the jam server: " << e.what() << std::endl;
+        status = 1;
+    }
+    return true;
+}
+
+} // namespace jam
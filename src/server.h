@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "build.h"
+#include "target.h"
+#include <string>
+
+namespace jam {
+
+// $XDG_RUNTIME_DIR/jam.sock, or /tmp/jam-<uid>.sock
+std::string getDefaultServerSocket();
+
+// jam --server: serve jam build requests on a Unix domain socket.
+//
+// The server initializes LLVM once and runs every build on one
+// BuildSession, so open caches, decoded module interfaces and
+// TargetMachines carry over from one request to the next. Requests are
+// handled one at a time; each build still compiles its modules in
+// parallel. A stale socket file left by a server that exited is replaced.
+// Runs until killed; returns the exit status if it can't start.
+int runServer(const std::string& socketPath, const Target& target);
+
+// jam build --use-server: run the build on the server at socketPath, with
+// its messages printed here. The client makes every path in options
+// absolute first, since the server has its own working directory. Returns
+// false, having done nothing, if no server is listening.
+bool forwardBuild(const std::string& socketPath, const BuildOptions& options, int& status);
+
+} // namespace jam
+
+#endif // SERVER_H
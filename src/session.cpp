@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "session.h"
+#include "ast.h"
+#include "codegen.h"
+#include "multiversion.h"
+#include "parser.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Verifier.h"
+#include <stdexcept>
+
+namespace jam {
+
+Session::Session(const Target& target, const CPUModel& cpu, OptLevel level, Compilation compilation)
+    : context_(std::make_unique<llvm::LLVMContext>()),
+      target_(target),
+      cpu_(cpu),
+      layouts_(target, target.getCacheLineSize()),
+      jit_(cpu, level),
+      compilation_(compilation),
+      targetMachine_(level == OptLevel::O0 ? nullptr : JIT::createTargetMachine(cpu, level)) {
+    options_.level = level;
+}
+
+// A new module sees earlier definitions only through declarations, and only
+// for the names this input mentions, so the cost doesn't grow with the session
+std::unique_ptr<llvm::Module> Session::createModule(const std::vector<Token>& tokens) {
+    auto contextLock = context_.getLock();
+    CurrentLayouts = &layouts_;
+    CodegenTarget = &target_;
+    CodegenCPU = &cpu_;
+
+    auto module = std::make_unique<llvm::Module>("jam.session." + std::to_string(counter_++), getContext());
+    module->setDataLayout(jit_.getDataLayout());
+
+    llvm::IRBuilder<> builder(getContext());
+    std::map<std::string, llvm::Value*> namedValues;
+    for (const auto& token : tokens) {
+        auto it = prototypes_.find(token.lexeme);
+        if (token.type != TOK_IDENTIFIER || it == prototypes_.end() || module->getFunction(token.lexeme)) {
+            continue;
+        }
+        FunctionAST decl(token.lexeme, it->second.args, it->second.returnType, {}, /*isExtern=*/true);
+        decl.codegen(builder, module.get(), namedValues);
+    }
+    return module;
+}
+
+void Session::finishModule(std::unique_ptr<llvm::Module> module) {
+    // Everything must stay visible to the modules that come after it
+    for (auto& func : *module) {
+        if (!func.isDeclaration()) {
+            func.setLinkage(llvm::Function::ExternalLinkage);
+        }
+    }
+    {
+        // The JIT compiles lazily on whichever thread calls in first, using
+        // the same context, so it has to be locked while this module changes
+        auto contextLock = context_.getLock();
+        if (llvm::verifyModule(*module, &llvm::errs())) {
+            throw std::runtime_error("generated invalid code");
+        }
+
+        lowerTargetClones(*module, target_, /*forJIT=*/true);
+        if (targetMachine_) {
+            optimizeModule(*module, targetMachine_.get(), options_);
+        }
+    }
+    llvm::orc::ThreadSafeModule threadSafeModule(std::move(module), context_);
+    if (compilation_ == Compilation::Eager) {
+        jit_.addCompiledModule(std::move(threadSafeModule));
+    } else {
+        jit_.addModule(std::move(threadSafeModule));
+    }
+}
+
+void Session::addDefinitions(const std::string& source) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Lexer lexer(source);
+    std::vector<Token> tokens = lexer.scanTokens();
+    Parser parser(tokens);
+    std::vector<std::unique_ptr<FunctionAST>> functions = parser.parse();
+    if (!parser.getCImports().empty() || !parser.getImports().empty()) {
+        throw std::runtime_error("imports are not supported here");
+    }
+    for (const auto& function : functions) {
+        // Redeclaring an extern (or host) function is harmless; redefining is not
+        if (prototypes_.count(function->Name) && !function->isExtern) {
+            throw std::runtime_error(function->Name + " is already defined");
+        }
+    }
+
+    std::unique_ptr<llvm::Module> module;
+    {
+        auto contextLock = context_.getLock();
+        module = createModule(tokens);
+        llvm::IRBuilder<> builder(getContext());
+        std::map<std::string, llvm::Value*> namedValues;
+        for (auto& structDecl : parser.getStructs()) {
+            structDecl->codegen(module.get(), layouts_);
+        }
+        for (auto& function : functions) {
+            if (function->isExtern && module->getFunction(function->Name)) {
+                continue;
+            }
+            function->codegen(builder, module.get(), namedValues);
+        }
+    }
+    finishModule(std::move(module));
+
+    for (const auto& function : functions) {
+        prototypes_[function->Name] = {function->Args, function->ReturnType};
+    }
+
+    // The JIT only materializes a module when one of its symbols is first
+    // looked up; do that here so no other thread's lookup ends up compiling
+    if (compilation_ == Compilation::Eager) {
+        for (const auto& function : functions) {
+            if (!function->isExtern) {
+                jit_.lookup(function->Name);
+            }
+        }
+    }
+}
+
+void Session::addHostFunction(const std::string& name, void* address, const std::string& signature) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!address) {
+        throw std::runtime_error("host function " + name + " has no address");
+    }
+    if (prototypes_.count(name)) {
+        throw std::runtime_error(name + " is already defined");
+    }
+
+    // Parse the signature as the extern declaration it stands for
+    Lexer lexer("extern fn " + name + signature + ";");
+    Parser parser(lexer.scanTokens());
+    std::vector<std::unique_ptr<FunctionAST>> functions = parser.parse();
+    if (functions.size() != 1 || functions[0]->Name != name || !parser.getStructs().empty()) {
+        throw std::runtime_error("invalid signature for host function " + name + ": " + signature);
+    }
+
+    jit_.defineSymbol(name, address);
+    prototypes_[name] = {functions[0]->Args, functions[0]->ReturnType};
+}
+
+void* Session::lookup(const std::string& name) {
+    return jit_.lookup(name);
+}
+
+} // namespace jam
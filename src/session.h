@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "jit.h"
+#include "layout.h"
+#include "lexer.h"
+#include "optimizer.h"
+#include "target.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Target/TargetMachine.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace jam {
+
+// A persistent JIT that Jam code is added to piece by piece, shared by the
+// REPL and libjam.
+//
+// Every addition is code-generated into its own small module. Later modules
+// see earlier definitions (and host functions) through declarations, so only
+// new code is compiled. Lazy sessions compile each function on first call;
+// eager sessions compile on add, so lookup returns the function itself
+// rather than a lazy stub and calls through it cost a plain indirect call.
+//
+// Code generation state (CurrentLayouts, CodegenTarget) is per thread, and
+// each call points it at this session. addDefinitions and addHostFunction
+// are serialized per session, and code generation holds the context lock the
+// JIT takes when it compiles, so lookup and the compiled code are safe to use
+// from any thread.
+class Session {
+public:
+    enum class Compilation { Lazy, Eager };
+
+    // Throws std::runtime_error if the JIT cannot be set up
+    Session(const Target& target, const CPUModel& cpu, OptLevel level, Compilation compilation = Compilation::Lazy);
+
+    // Compile fn, extern fn and struct definitions. Throws std::runtime_error
+    // on a syntax or type error or when a function is already defined.
+    void addDefinitions(const std::string& source);
+
+    // Make a host function callable from Jam code added afterwards. signature
+    // uses Jam syntax, e.g. "(x: u32, y: u32) -> u32".
+    void addHostFunction(const std::string& name, void* address, const std::string& signature);
+
+    // Address of a compiled function. Throws if undefined.
+    void* lookup(const std::string& name);
+
+    // For callers that generate their own code (REPL statements): a module
+    // declaring the earlier definitions tokens mentions, and a way to add it
+    std::unique_ptr<llvm::Module> createModule(const std::vector<Token>& tokens);
+    void finishModule(std::unique_ptr<llvm::Module> module);
+
+    llvm::LLVMContext& getContext() { return *context_.getContext(); }
+
+private:
+    struct Prototype {
+        std::vector<std::pair<std::string, std::string>> args;
+        std::string returnType;
+    };
+
+    llvm::orc::ThreadSafeContext context_;
+    Target target_;
+    CPUModel cpu_;
+    LayoutEngine layouts_;
+    JIT jit_;
+    Compilation compilation_;
+    std::unique_ptr<llvm::TargetMachine> targetMachine_;
+    OptimizationOptions options_;
+    std::map<std::string, Prototype> prototypes_;
+    unsigned counter_ = 0;
+    std::mutex mutex_;
+};
+
+} // namespace jam
+
+#endif // SESSION_H
@@ -6,7 +6,12 @@
  */
 
 #include "target.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/MC/MCSubtargetInfo.h"
+#include "llvm/MC/TargetRegistry.h"
 #include "llvm/TargetParser/Host.h"
+#include <algorithm>
+#include <memory>
 #include <sstream>
 
 namespace jam {
@@ -129,26 +134,30 @@ std::string Target::toLLVMTriple() const {
     return oss.str();
 }
 
-std::string Target::getName() const {
-    std::ostringstream oss;
-    
+const char* Target::getArchName() const {
     switch (arch) {
-        case Arch::X86_64:   oss << "x86_64"; break;
-        case Arch::AArch64:  oss << "aarch64"; break;
-        case Arch::ARM:      oss << "arm"; break;
-        case Arch::RISCV64:  oss << "riscv64"; break;
-        default:             oss << "unknown"; break;
+        case Arch::X86_64:   return "x86_64";
+        case Arch::AArch64:  return "aarch64";
+        case Arch::ARM:      return "arm";
+        case Arch::RISCV64:  return "riscv64";
+        default:             return "unknown";
     }
-    
-    oss << "-";
-    
+}
+
+const char* Target::getOSName() const {
     switch (os) {
-        case OS::Linux:    oss << "linux"; break;
-        case OS::MacOS:    oss << "macos"; break;
-        case OS::Windows:  oss << "windows"; break;
-        case OS::FreeBSD:  oss << "freebsd"; break;
-        default:           oss << "unknown"; break;
+        case OS::Linux:    return "linux";
+        case OS::MacOS:    return "macos";
+        case OS::Windows:  return "windows";
+        case OS::FreeBSD:  return "freebsd";
+        default:           return "unknown";
     }
+}
+
+std::string Target::getName() const {
+    std::ostringstream oss;
+    
+    oss << getArchName() << "-" << getOSName();
     
     if (abi != ABI::None && abi != ABI::Unknown) {
         oss << "-";
@@ -237,10 +246,102 @@ int Target::getPointerAlignment() const {
     return getPointerSize();
 }
 
+int Target::getCacheLineSize() const {
+    // Apple silicon uses 128-byte lines; everything else we target uses 64
+    if (arch == Arch::AArch64 && os == OS::MacOS) {
+        return 128;
+    }
+    return 64;
+}
+
 Target::CallingConvention Target::getDefaultCC() const {
     // Most platforms use C calling convention by default
     // We could optimize with Fast for internal functions later
     return CallingConvention::C;
 }
 
+CPUModel CPUModel::getHostCPU() {
+    CPUModel cpu;
+    cpu.name = llvm::sys::getHostCPUName().str();
+
+    llvm::StringMap<bool> hostFeatures;
+    if (llvm::sys::getHostCPUFeatures(hostFeatures)) {
+        // Sort for a stable feature string (it is part of cache keys and reports)
+        std::vector<std::string> names;
+        for (const auto& feature : hostFeatures) {
+            names.push_back((feature.getValue() ? "+" : "-") + feature.getKey().str());
+        }
+        std::sort(names.begin(), names.end(), [](const std::string& a, const std::string& b) {
+            return a.substr(1) < b.substr(1);
+        });
+        for (const auto& name : names) {
+            cpu.addFeatures(name);
+        }
+    }
+
+    return cpu;
+}
+
+void CPUModel::addFeatures(const std::string& extra) {
+    if (extra.empty()) return;
+    features = features.empty() ? extra : features + "," + extra;
+}
+
+std::vector<std::string> CPUModel::getFeatureList() const {
+    std::vector<std::string> list;
+    std::stringstream ss(features);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) {
+            list.push_back(item);
+        }
+    }
+    return list;
+}
+
+bool CPUModel::hasFeature(const std::string& feature) const {
+    bool enabled = false;
+    for (const auto& item : getFeatureList()) {
+        if (item.substr(1) == feature) {
+            enabled = item[0] == '+';
+        }
+    }
+    return enabled;
+}
+
+int CPUModel::getVectorBits(const Target& target) const {
+    // Ask LLVM what the selected CPU plus feature overrides actually enable,
+    // so names like "skylake-avx512" resolve without an explicit feature list
+    std::string error;
+    std::string triple = target.toLLVMTriple();
+    if (const llvm::Target* llvmTarget = llvm::TargetRegistry::lookupTarget(triple, error)) {
+        std::unique_ptr<llvm::MCSubtargetInfo> sti(llvmTarget->createMCSubtargetInfo(triple, name, features));
+        if (sti) {
+            switch (target.arch) {
+                case Arch::X86_64:
+                    if (sti->checkFeatures("+avx512f")) return 512;
+                    if (sti->checkFeatures("+avx")) return 256;
+                    return 128;  // SSE2 is part of the x86-64 baseline
+                case Arch::AArch64:
+                case Arch::ARM:
+                    return sti->checkFeatures("+neon") ? 128 : 0;
+                default:
+                    break;
+            }
+        }
+    }
+
+    // Target not registered in this build: use the explicit feature list
+    switch (target.arch) {
+        case Arch::X86_64:
+            if (hasFeature("avx512f")) return 512;
+            if (hasFeature("avx") || hasFeature("avx2")) return 256;
+            return 128;
+        case Arch::AArch64:
+            return 128;
+        default:
+            return 0;
+    }
+}
+
 } // namespace jam
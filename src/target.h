@@ -9,6 +9,7 @@
 #define TARGET_H
 
 #include <string>
+#include <vector>
 #include "llvm/TargetParser/Triple.h"
 
 namespace jam {
@@ -61,6 +62,8 @@ struct Target {
     
     // Get human-readable name
     std::string getName() const;
+    const char* getArchName() const;
+    const char* getOSName() const;
     
     // Target characteristics
     bool requiresLibC() const;
@@ -73,6 +76,7 @@ struct Target {
     const char* getLibCName() const;
     int getPointerSize() const;  // in bytes
     int getPointerAlignment() const;  // in bytes
+    int getCacheLineSize() const;  // in bytes
     
     // Calling convention
     enum class CallingConvention {
@@ -85,6 +89,27 @@ struct Target {
     CallingConvention getDefaultCC() const;
 };
 
+// CPU model and feature set used for code generation (--cpu, --features, -march)
+struct CPUModel {
+    std::string name = "generic";
+    std::string features;  // LLVM feature string, e.g. "+avx2,+fma"
+
+    // Host CPU name and features, as used by -march=native
+    static CPUModel getHostCPU();
+
+    // Append features such as "+avx2,-avx512f"; later entries win
+    void addFeatures(const std::string& extra);
+
+    // Split feature list (for EngineBuilder::setMAttrs)
+    std::vector<std::string> getFeatureList() const;
+
+    // Whether a feature (without +/-) is enabled
+    bool hasFeature(const std::string& feature) const;
+
+    // Widest SIMD register width in bits for this CPU on the given target
+    int getVectorBits(const Target& target) const;
+};
+
 // Common target configurations
 namespace targets {
     inline Target x86_64_linux_gnu()   { return Target(Arch::X86_64, OS::Linux, ABI::GNU); }
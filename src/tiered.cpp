@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "tiered.h"
+#include "jit.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/ExecutionEngine/Orc/CompileUtils.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include <chrono>
+#include <iostream>
+#include <map>
+
+namespace jam {
+
+// Module identifier prefix of re-optimized functions
+static const std::string Tier2Prefix = "jam.tier2.";
+
+// Picks the backend per module: -O0 (fast instruction selection) for tier 0,
+// the hot level for modules built by the tier-up thread. Each target machine
+// is only used from one thread: tier 0 from addModule, the hot one from the
+// worker.
+class TieredCompiler : public llvm::orc::IRCompileLayer::IRCompiler {
+public:
+    TieredCompiler(std::unique_ptr<llvm::TargetMachine> fast, std::unique_ptr<llvm::TargetMachine> hot)
+        : IRCompiler(llvm::orc::irManglingOptionsFromTargetOptions(fast->Options)),
+          fast_(std::move(fast)), hot_(std::move(hot)) {}
+
+    llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>> operator()(llvm::Module& module) override {
+        bool isHot = module.getModuleIdentifier().rfind(Tier2Prefix, 0) == 0;
+        llvm::orc::SimpleCompiler compile(isHot ? *hot_ : *fast_);
+        return compile(module);
+    }
+
+private:
+    std::unique_ptr<llvm::TargetMachine> fast_;
+    std::unique_ptr<llvm::TargetMachine> hot_;
+};
+
+TieredJIT::TieredJIT(const CPUModel& cpu, OptLevel hotLevel, unsigned threshold, bool verbose)
+    : cpu_(cpu), hotLevel_(hotLevel), threshold_(threshold), verbose_(verbose) {
+    auto builder = JIT::getTargetMachineBuilder(cpu, OptLevel::O0);
+    llvm::Triple triple = builder.getTargetTriple();
+    auto fast = JIT::createTargetMachine(cpu, OptLevel::O0);
+    auto hot = JIT::createTargetMachine(cpu, hotLevel);
+
+    jit_ = unwrapOrThrow(llvm::orc::LLJITBuilder()
+                             .setJITTargetMachineBuilder(std::move(builder))
+                             .setCompileFunctionCreator([&fast, &hot](llvm::orc::JITTargetMachineBuilder)
+                                     -> llvm::Expected<std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
+                                 return std::make_unique<TieredCompiler>(std::move(fast), std::move(hot));
+                             })
+                             .create(),
+                         "Failed to create JIT");
+
+    llvm::orc::JITDylib& dylib = jit_->getMainJITDylib();
+    auto generator = unwrapOrThrow(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+                                       jit_->getDataLayout().getGlobalPrefix()),
+                                   "Failed to load host symbols");
+    dylib.addGenerator(std::move(generator));
+
+    // Tier-0 code calls back into this object when a counter fires
+    llvm::orc::SymbolMap callbacks;
+    callbacks[jit_->mangleAndIntern("__jam_tier_up")] = llvm::orc::ExecutorSymbolDef(
+        llvm::orc::ExecutorAddr::fromPtr(&tierUpCallback), llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable);
+    throwIfError(dylib.define(llvm::orc::absoluteSymbols(std::move(callbacks))), "Failed to define tier-up callback");
+
+    stubs_ = llvm::orc::createLocalIndirectStubsManagerBuilder(triple)();
+    worker_ = std::thread([this] { runWorker(); });
+}
+
+TieredJIT::~TieredJIT() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        queue_.clear();
+    }
+    wake_.notify_all();
+    worker_.join();
+}
+
+const llvm::DataLayout& TieredJIT::getDataLayout() const {
+    return jit_->getDataLayout();
+}
+
+void TieredJIT::addModule(std::unique_ptr<llvm::Module> module, std::unique_ptr<llvm::LLVMContext> context) {
+    // Tier-0 and tier-2 code live in different modules and call each other by name
+    for (auto& func : *module) {
+        if (!func.isDeclaration()) {
+            func.setLinkage(llvm::Function::ExternalLinkage);
+        }
+    }
+
+    bitcode_.clear();
+    llvm::raw_string_ostream out(bitcode_);
+    llvm::WriteBitcodeToFile(*module, out);
+    out.flush();
+
+    size_t first = functions_.size();
+    instrument(*module);
+
+    // The public name of each function is its stub; tier 0 and tier 2 are
+    // only reached through it
+    llvm::orc::SymbolMap stubSymbols;
+    for (size_t id = first; id < functions_.size(); id++) {
+        const std::string& name = functions_[id];
+        throwIfError(stubs_->createStub(name, llvm::orc::ExecutorAddr(), llvm::JITSymbolFlags::Exported),
+                     "Failed to create stub for " + name);
+        stubSymbols[jit_->mangleAndIntern(name)] = llvm::orc::ExecutorSymbolDef(
+            stubs_->findStub(name, false).getAddress(), llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable);
+    }
+    throwIfError(jit_->getMainJITDylib().define(llvm::orc::absoluteSymbols(std::move(stubSymbols))),
+                 "Failed to define stubs");
+
+    throwIfError(jit_->addIRModule(llvm::orc::ThreadSafeModule(std::move(module), std::move(context))),
+                 "Failed to add module to JIT");
+
+    for (size_t id = first; id < functions_.size(); id++) {
+        const std::string& name = functions_[id];
+        auto tier0 = unwrapOrThrow(jit_->lookup(name + ".tier0"), "Failed to compile " + name);
+        throwIfError(stubs_->updatePointer(name, tier0), "Failed to update stub for " + name);
+    }
+}
+
+void* TieredJIT::lookup(const std::string& name) {
+    auto symbol = unwrapOrThrow(jit_->lookup(name), "JIT symbol lookup failed");
+    return symbol.toPtr<void*>();
+}
+
+void TieredJIT::tierUpCallback(TieredJIT* self, uint32_t id) {
+    {
+        std::lock_guard<std::mutex> lock(self->mutex_);
+        if (self->stopping_ || !self->promoted_.insert(id).second) {
+            return;
+        }
+        self->queue_.push_back(id);
+    }
+    self->wake_.notify_one();
+}
+
+// Rename every body to <name>.tier0 behind a declaration of <name> (the
+// stub), and count entries and loop back-edges. A counter calls
+// __jam_tier_up exactly once, when it reaches the threshold.
+void TieredJIT::instrument(llvm::Module& module) {
+    llvm::LLVMContext& context = module.getContext();
+    llvm::Type* i32 = llvm::Type::getInt32Ty(context);
+    llvm::Type* i64 = llvm::Type::getInt64Ty(context);
+    llvm::Type* i8Ptr = llvm::PointerType::get(llvm::Type::getInt8Ty(context), 0);
+
+    llvm::FunctionCallee tierUp = module.getOrInsertFunction(
+        "__jam_tier_up", llvm::FunctionType::get(llvm::Type::getVoidTy(context), {i8Ptr, i32}, false));
+    llvm::Constant* self = llvm::ConstantExpr::getIntToPtr(
+        llvm::ConstantInt::get(i64, reinterpret_cast<uintptr_t>(this)), i8Ptr);
+    llvm::MDNode* unlikely = llvm::MDBuilder(context).createBranchWeights(1, 1 << 20);
+
+    std::vector<llvm::Function*> defined;
+    for (auto& func : module) {
+        if (!func.isDeclaration()) {
+            defined.push_back(&func);
+        }
+    }
+
+    for (llvm::Function* func : defined) {
+        uint32_t id = static_cast<uint32_t>(functions_.size());
+        std::string name = func->getName().str();
+        functions_.push_back(name);
+
+        func->setName(name + ".tier0");
+        llvm::Function* stub = llvm::Function::Create(func->getFunctionType(), llvm::Function::ExternalLinkage, name, &module);
+        func->replaceAllUsesWith(stub);
+
+        auto* counter = new llvm::GlobalVariable(module, i32, false, llvm::GlobalValue::InternalLinkage,
+                                                 llvm::ConstantInt::get(i32, 0), name + ".counter");
+
+        // Entry, after the allocas so they stay in the entry block
+        llvm::BasicBlock& entry = func->getEntryBlock();
+        auto entryPoint = entry.begin();
+        while (llvm::isa<llvm::AllocaInst>(*entryPoint)) {
+            ++entryPoint;
+        }
+        std::vector<llvm::Instruction*> points = {&*entryPoint};
+
+        // A branch to a block at or before its own position closes a loop
+        std::map<llvm::BasicBlock*, unsigned> order;
+        for (auto& block : *func) {
+            order[&block] = static_cast<unsigned>(order.size());
+        }
+        for (auto& block : *func) {
+            llvm::Instruction* terminator = block.getTerminator();
+            if (!terminator) {
+                continue;
+            }
+            for (llvm::BasicBlock* successor : llvm::successors(&block)) {
+                if (order[successor] <= order[&block]) {
+                    points.push_back(terminator);
+                    break;
+                }
+            }
+        }
+
+        for (llvm::Instruction* point : points) {
+            llvm::IRBuilder<> builder(point);
+            llvm::Value* count = builder.CreateAdd(builder.CreateLoad(i32, counter), llvm::ConstantInt::get(i32, 1));
+            builder.CreateStore(count, counter);
+            llvm::Value* reached = builder.CreateICmpEQ(count, llvm::ConstantInt::get(i32, threshold_));
+            llvm::Instruction* then = llvm::SplitBlockAndInsertIfThen(reached, point, false, unlikely);
+            llvm::IRBuilder<>(then).CreateCall(tierUp, {self, llvm::ConstantInt::get(i32, id)});
+        }
+    }
+}
+
+void TieredJIT::runWorker() {
+    llvm::orc::ThreadSafeContext context(std::make_unique<llvm::LLVMContext>());
+    std::unique_ptr<llvm::Module> base;
+    std::unique_ptr<llvm::TargetMachine> targetMachine;
+    OptimizationOptions options;
+    options.level = hotLevel_;
+
+    while (true) {
+        unsigned id;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (stopping_) {
+                return;
+            }
+            id = queue_.front();
+            queue_.pop_front();
+        }
+
+        const std::string& name = functions_[id];
+        auto start = std::chrono::steady_clock::now();
+        try {
+            std::unique_ptr<llvm::Module> module;
+            {
+                auto lock = context.getLock();
+                if (!base) {
+                    base = unwrapOrThrow(llvm::parseBitcodeFile(llvm::MemoryBufferRef(bitcode_, "jam.tier0"),
+                                                                *context.getContext()),
+                                         "Failed to read tier-0 IR");
+                    targetMachine = JIT::createTargetMachine(cpu_, hotLevel_);
+                }
+                module = llvm::CloneModule(*base);
+                module->setModuleIdentifier(Tier2Prefix + name);
+
+                // Other functions stay callable through their stubs and visible to the inliner
+                llvm::Function* hot = module->getFunction(name);
+                for (auto& func : *module) {
+                    if (!func.isDeclaration() && &func != hot) {
+                        func.setLinkage(llvm::Function::AvailableExternallyLinkage);
+                    }
+                }
+                hot->setName(name + ".tier2");
+                llvm::Function* stub = llvm::Function::Create(hot->getFunctionType(), llvm::Function::ExternalLinkage,
+                                                              name, module.get());
+                hot->replaceAllUsesWith(stub);
+
+                optimizeModule(*module, targetMachine.get(), options);
+            }
+
+            throwIfError(jit_->addIRModule(llvm::orc::ThreadSafeModule(std::move(module), context)),
+                         "Failed to add module to JIT");
+            auto tier2 = unwrapOrThrow(jit_->lookup(name + ".tier2"), "Failed to compile " + name);
+            throwIfError(stubs_->updatePointer(name, tier2), "Failed to update stub for " + name);
+
+            if (verbose_) {
+                auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start);
+                std::cerr << "[tier-up] " << name << " -> -O" << static_cast<int>(hotLevel_) << " in "
+                          << elapsed.count() / 1000.0 << " ms" << std::endl;
+            }
+        } catch (const std::exception& e) {
+            // The function keeps running its tier-0 code
+            if (verbose_) {
+                std::cerr << "[tier-up] " << name << " failed: " << e.what() << std::endl;
+            }
+        }
+    }
+}
+
+} // namespace jam
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef TIERED_H
+#define TIERED_H
+
+#include "optimizer.h"
+#include "target.h"
+#include "llvm/ExecutionEngine/Orc/IndirectionUtils.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace jam {
+
+// Tiered JIT for --run --tiered.
+//
+// Tier 0: every function is compiled up front with no IR optimization and
+// the fast instruction selector, plus a counter bumped on entry and on each
+// loop back-edge. All calls, including the one into main, go through an ORC
+// indirection stub per function.
+//
+// Tier up: when a counter reaches the threshold, the function is queued for
+// a background thread. The thread rebuilds it from the unoptimized IR, with
+// the other functions available for inlining, runs the hot -O pipeline and
+// atomically repoints the function's stub to the new code. Frames already
+// running tier-0 code finish there; there is no on-stack replacement.
+class TieredJIT {
+public:
+    static constexpr unsigned DefaultThreshold = 1000;
+
+    TieredJIT(const CPUModel& cpu, OptLevel hotLevel, unsigned threshold = DefaultThreshold, bool verbose = false);
+    ~TieredJIT();
+
+    const llvm::DataLayout& getDataLayout() const;
+
+    // Compile the module at tier 0 and route every function through its stub
+    void addModule(std::unique_ptr<llvm::Module> module, std::unique_ptr<llvm::LLVMContext> context);
+
+    // Stub address of a function added by addModule
+    void* lookup(const std::string& name);
+
+private:
+    const CPUModel cpu_;
+    OptLevel hotLevel_;
+    unsigned threshold_;
+    bool verbose_;
+    std::unique_ptr<llvm::orc::LLJIT> jit_;
+    std::unique_ptr<llvm::orc::IndirectStubsManager> stubs_;
+
+    // Unoptimized IR of the program, the source for every tier-up
+    std::string bitcode_;
+    std::vector<std::string> functions_;  // indexed by counter id
+
+    // Background re-optimization
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<unsigned> queue_;
+    std::set<unsigned> promoted_;
+    bool stopping_ = false;
+    std::thread worker_;
+
+    static void tierUpCallback(TieredJIT* self, uint32_t id);
+    void instrument(llvm::Module& module);
+    void runWorker();
+};
+
+} // namespace jam
+
+#endif // TIERED_H
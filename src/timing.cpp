@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#include "timing.h"
+#include "llvm/Support/Error.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace jam {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Report order; other phase names follow, alphabetically
+const char* const PhaseOrder[] = {"Read", "Lex", "Parse", "Codegen", "Verify", "Optimize", "Emit", "Link"};
+
+struct PhaseTotal {
+    Clock::duration time{};
+    uint64_t count = 0;
+};
+
+std::atomic<bool> reportEnabled{false};
+std::string traceFile;
+unsigned traceGranularity = 0;
+Clock::time_point startTime;
+
+std::mutex reportMutex;
+std::map<std::string, PhaseTotal> phaseTotals;
+// Min-heap of the slowest functions to generate, at most SlowestFunctionCount
+std::vector<std::pair<Clock::duration, std::string>> slowestFunctions;
+
+void record(const char* phase, const std::string& detail, Clock::duration elapsed) {
+    std::lock_guard<std::mutex> lock(reportMutex);
+    PhaseTotal& total = phaseTotals[phase];
+    total.time += elapsed;
+    total.count++;
+
+    if (detail.empty() || llvm::StringRef(phase) != "Codegen") {
+        return;
+    }
+    auto slower = std::greater<std::pair<Clock::duration, std::string>>();
+    if (slowestFunctions.size() < SlowestFunctionCount) {
+        slowestFunctions.emplace_back(elapsed, detail);
+        std::push_heap(slowestFunctions.begin(), slowestFunctions.end(), slower);
+    } else if (elapsed > slowestFunctions.front().first) {
+        std::pop_heap(slowestFunctions.begin(), slowestFunctions.end(), slower);
+        slowestFunctions.back() = {elapsed, detail};
+        std::push_heap(slowestFunctions.begin(), slowestFunctions.end(), slower);
+    }
+}
+
+double toMillis(Clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+void printReport(std::ostream& os) {
+    std::lock_guard<std::mutex> lock(reportMutex);
+    std::vector<std::pair<std::string, PhaseTotal>> phases;
+    for (const char* name : PhaseOrder) {
+        auto found = phaseTotals.find(name);
+        if (found != phaseTotals.end()) {
+            phases.push_back(*found);
+        }
+    }
+    for (const auto& entry : phaseTotals) {
+        if (std::find(std::begin(PhaseOrder), std::end(PhaseOrder), entry.first) == std::end(PhaseOrder)) {
+            phases.push_back(entry);
+        }
+    }
+    Clock::duration sum{};
+    for (const auto& phase : phases) {
+        sum += phase.second.time;
+    }
+
+    char line[128];
+    os << "===== jam time report =====" << std::endl;
+    std::snprintf(line, sizeof(line), "%-12s %12s %8s %10s", "Phase", "Time (ms)", "%", "Count");
+    os << line << std::endl;
+    for (const auto& phase : phases) {
+        double share = sum.count() ? 100.0 * phase.second.time.count() / sum.count() : 0.0;
+        std::snprintf(line, sizeof(line), "%-12s %12.3f %7.1f%% %10llu", phase.first.c_str(),
+                      toMillis(phase.second.time), share, static_cast<unsigned long long>(phase.second.count));
+        os << line << std::endl;
+    }
+    std::snprintf(line, sizeof(line), "%-12s %12.3f", "Total", toMillis(sum));
+    os << line << std::endl;
+    std::snprintf(line, sizeof(line), "%-12s %12.3f", "Wall", toMillis(Clock::now() - startTime));
+    os << line << std::endl;
+
+    if (!slowestFunctions.empty()) {
+        auto functions = slowestFunctions;
+        std::sort(functions.begin(), functions.end(), std::greater<>());
+        os << std::endl << "Slowest functions to generate:" << std::endl;
+        for (const auto& function : functions) {
+            std::snprintf(line, sizeof(line), "  %12.3f ms  ", toMillis(function.first));
+            os << line << function.second << std::endl;
+        }
+    }
+}
+
+} // namespace
+
+void startTiming(bool report, const std::string& tracePath, unsigned granularityMicros) {
+    startTime = Clock::now();
+    reportEnabled = report;
+    traceFile = tracePath;
+    traceGranularity = granularityMicros;
+    if (!traceFile.empty()) {
+        llvm::timeTraceProfilerInitialize(traceGranularity, "jam");
+    }
+}
+
+bool finishTiming(std::ostream& os) {
+    if (reportEnabled) {
+        printReport(os);
+    }
+    if (traceFile.empty()) {
+        return true;
+    }
+    bool written = true;
+    if (llvm::Error error = llvm::timeTraceProfilerWrite(traceFile, traceFile)) {
+        os << "Error: could not write " << traceFile << ": " << llvm::toString(std::move(error)) << std::endl;
+        written = false;
+    }
+    llvm::timeTraceProfilerCleanup();
+    return written;
+}
+
+void startTimingThread() {
+    if (!traceFile.empty()) {
+        llvm::timeTraceProfilerInitialize(traceGranularity, "jam");
+    }
+}
+
+void finishTimingThread() {
+    if (!traceFile.empty()) {
+        llvm::timeTraceProfilerFinishThread();
+    }
+}
+
+TimeScope::TimeScope(const char* phase, llvm::StringRef detail)
+    : trace_(phase, detail), phase_(phase), reporting_(reportEnabled.load(std::memory_order_relaxed)) {
+    if (reporting_) {
+        detail_ = detail.str();
+        start_ = Clock::now();
+    }
+}
+
+TimeScope::~TimeScope() {
+    if (reporting_) {
+        record(phase_, detail_, Clock::now() - start_);
+    }
+}
+
+} // namespace jam
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/TimeProfiler.h"
+#include <chrono>
+#include <ostream>
+#include <string>
+
+namespace jam {
+
+// --time-report and --time-trace: where compile time goes.
+//
+// Each phase of the compiler (Read, Lex, Parse, Codegen, Verify, Optimize,
+// Emit, Link) is wrapped in a TimeScope. With --time-trace the scopes, and
+// the LLVM passes run inside them, are recorded by LLVM's time trace
+// profiler and written as a Chrome trace (chrome://tracing, Perfetto).
+// With --time-report the time of each phase is summed, along with the
+// functions whose code generation took longest, and printed as a table.
+// When neither is on a TimeScope costs two loads and branches.
+//
+// Phases on worker threads are included; each worker calls
+// startTimingThread() when it starts and finishTimingThread() before it
+// exits. Times in the report are summed over threads, so phases that run in
+// parallel can add up to more than the wall time.
+void startTiming(bool report, const std::string& tracePath, unsigned granularityMicros);
+
+// Print the report to os and write the trace. Returns false, having printed
+// the reason, if the trace can't be written.
+bool finishTiming(std::ostream& os);
+
+void startTimingThread();
+void finishTimingThread();
+
+// Number of functions listed in the report
+constexpr size_t SlowestFunctionCount = 10;
+
+class TimeScope {
+public:
+    // detail names what the phase works on, e.g. the function being generated
+    explicit TimeScope(const char* phase, llvm::StringRef detail = "");
+    ~TimeScope();
+
+    TimeScope(const TimeScope&) = delete;
+    TimeScope& operator=(const TimeScope&) = delete;
+
+private:
+    llvm::TimeTraceScope trace_;
+    const char* phase_;
+    std::string detail_;
+    bool reporting_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace jam
+
+#endif // TIMING_H
@@ -51,6 +51,14 @@ enum TokenType {
     TOK_IN,
     TOK_EXTERN,    // extern keyword
     TOK_EXPORT,    // export keyword
+    TOK_STRUCT,    // struct keyword
+    TOK_DOT,       // field access
+    TOK_AT,        // attribute/builtin prefix
+    TOK_BANG,      // error union prefix (!T)
+    TOK_TRY,       // try keyword
+    TOK_CATCH,     // catch keyword
+    TOK_ERROR,     // error keyword
+    TOK_IMPORT,    // import keyword
 };
 
 // Token structure
@@ -0,0 +1,13 @@
+/*
+ * Copyright (c) 2025 Raphael Amorim
+ *
+ * This file is part of jam, which is MIT licensed.
+ * See http://opensource.org/licenses/MIT
+ */
+
+#ifndef VERSION_H
+#define VERSION_H
+
+#define JAM_VERSION "0.1.0"
+
+#endif // VERSION_H
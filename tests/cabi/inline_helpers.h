@@ -0,0 +1,23 @@
+/*
+ * Header-only C helpers imported with @cImport
+ */
+
+#ifndef INLINE_HELPERS_H
+#define INLINE_HELPERS_H
+
+#include <stdint.h>
+
+struct Pair {
+    int32_t first;
+    int32_t second;
+};
+
+// Regular prototype: becomes an extern fn
+int32_t add_numbers(int32_t a, int32_t b);
+
+// No symbol to link against: compiled to bitcode and inlined
+static inline uint32_t mix_u32(uint32_t h, uint32_t v) {
+    return (h ^ v) * 16777619u;
+}
+
+#endif // INLINE_HELPERS_H
@@ -0,0 +1,113 @@
+/*
+ * A C host embedding Jam through libjam
+ * Jam calls back into the host, and the host calls Jam from two threads
+ * while it compiles more code on a third
+ */
+
+#include "libjam.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+static uint32_t host_scale(uint32_t x) {
+    return x * 10;
+}
+
+typedef uint32_t (*scale_fn)(uint32_t);
+
+static void* worker(void* arg) {
+    scale_fn scale_plus_one = (scale_fn)arg;
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < 1000; i++) {
+        total += scale_plus_one(i % 4);
+    }
+    return (void*)(uintptr_t)total;
+}
+
+#define LATE_FUNCTIONS 50
+
+static jam_session* shared_session;
+
+// Looks up each late function as soon as it exists, while main compiles the next
+static void* late_caller(void* arg) {
+    (void)arg;
+    uintptr_t failures = 0;
+    for (uint32_t i = 0; i < LATE_FUNCTIONS; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "late_%u", i);
+        scale_fn late;
+        while (!(late = JAM_LOOKUP(shared_session, name, scale_fn))) {
+        }
+        if (late(1) != 1 + i) {
+            failures++;
+        }
+    }
+    return (void*)failures;
+}
+
+int main() {
+    jam_session* session = jam_session_create(2);
+    if (!session) {
+        printf("FAIL: %s\n", jam_last_error());
+        return 1;
+    }
+
+    if (jam_register_host_fn(session, "host_scale", (void*)&host_scale, "(x: u32) -> u32") != 0 ||
+        jam_compile_source(session,
+                           "fn scale_plus_one(n: u32) -> u32 {\n"
+                           "    return host_scale(n) + 1;\n"
+                           "}\n") != 0) {
+        printf("FAIL: %s\n", jam_last_error());
+        return 1;
+    }
+
+    scale_fn scale_plus_one = JAM_LOOKUP(session, "scale_plus_one", scale_fn);
+    if (!scale_plus_one || scale_plus_one(4) != 41) {
+        printf("FAIL: scale_plus_one(4)\n");
+        return 1;
+    }
+
+    // Compiled code is shared between threads without locking
+    pthread_t threads[2];
+    void* results[2];
+    for (int i = 0; i < 2; i++) {
+        pthread_create(&threads[i], NULL, worker, (void*)scale_plus_one);
+    }
+    for (int i = 0; i < 2; i++) {
+        pthread_join(threads[i], &results[i]);
+    }
+    if ((uintptr_t)results[0] != 16000 || (uintptr_t)results[1] != 16000) {
+        printf("FAIL: threaded calls\n");
+        return 1;
+    }
+
+    // Compiling on one thread while another looks up what was just added
+    shared_session = session;
+    pthread_t caller;
+    void* late_failures;
+    pthread_create(&caller, NULL, late_caller, NULL);
+    for (uint32_t i = 0; i < LATE_FUNCTIONS; i++) {
+        char source[128];
+        snprintf(source, sizeof(source), "fn late_%u(x: u32) -> u32 {\n    return x + %u;\n}\n", i, i);
+        if (jam_compile_source(session, source) != 0) {
+            printf("FAIL: %s\n", jam_last_error());
+            return 1;
+        }
+    }
+    pthread_join(caller, &late_failures);
+    if ((uintptr_t)late_failures != 0) {
+        printf("FAIL: lookups during compilation\n");
+        return 1;
+    }
+
+    // Errors are reported, not fatal
+    if (jam_compile_source(session, "fn scale_plus_one() -> u32 { return 0; }") == 0 ||
+        jam_lookup(session, "missing") != NULL) {
+        printf("FAIL: errors not reported\n");
+        return 1;
+    }
+
+    jam_session_destroy(session);
+    printf("PASS\n");
+    return 0;
+}